@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Minimal benchmark harness for simplesquirrel
+ * @details Every case is run with a growing number of iterations until
+ * it takes long enough to be measured. A case either loops with
+ * keepRunning() or calls start() and stop() around a batch of
+ * iterations() operations. Allocations are counted by the global
+ * operator new replaced in main.cpp, so they cover C++ heap allocations
+ * only, not the ones made by Squirrel itself.
+ */
+namespace bench {
+    /**
+     * @brief Number of calls to the global operator new so far
+     */
+    extern std::atomic<size_t> allocations;
+
+    class State {
+    public:
+        explicit State(size_t iterations):numIterations(iterations), remaining(iterations), running(false),
+            allocsBegin(0), allocsEnd(0) {
+        }
+        size_t iterations() const {
+            return numIterations;
+        }
+        void start() {
+            running = true;
+            allocsBegin = allocations.load(std::memory_order_relaxed);
+            begin = std::chrono::steady_clock::now();
+        }
+        void stop() {
+            end = std::chrono::steady_clock::now();
+            allocsEnd = allocations.load(std::memory_order_relaxed);
+            running = false;
+        }
+        bool keepRunning() {
+            if (!running && remaining == numIterations) {
+                start();
+            }
+            if (remaining == 0) {
+                stop();
+                return false;
+            }
+            --remaining;
+            return true;
+        }
+        double elapsedNs() const {
+            return std::chrono::duration<double, std::nano>(end - begin).count();
+        }
+        size_t allocs() const {
+            return allocsEnd - allocsBegin;
+        }
+
+    private:
+        size_t numIterations;
+        size_t remaining;
+        bool running;
+        size_t allocsBegin;
+        size_t allocsEnd;
+        std::chrono::steady_clock::time_point begin;
+        std::chrono::steady_clock::time_point end;
+    };
+
+    struct Case {
+        std::string name;
+        std::function<void(State&)> func;
+    };
+
+    inline std::vector<Case>& registry() {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, const std::function<void(State&)>& func) {
+            registry().push_back(Case{name, func});
+        }
+    };
+}
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+#define BENCH_CASE(name) \
+    static void BENCH_CONCAT(benchFunc, __LINE__)(bench::State& state); \
+    static bench::Registrar BENCH_CONCAT(benchRegistrar, __LINE__)(name, &BENCH_CONCAT(benchFunc, __LINE__)); \
+    static void BENCH_CONCAT(benchFunc, __LINE__)(bench::State& state)
@@ -0,0 +1,155 @@
+#include "bench.hpp"
+#include <simplesquirrel/simplesquirrel.hpp>
+
+#define STRINGIFY(x) #x
+
+class Vec : public ssq::ExposableClass {
+public:
+    Vec():x(0), y(0), z(0) {
+    }
+
+    Vec(int x, int y):x(x), y(y), z(0) {
+    }
+
+    int getZ() const {
+        return z;
+    }
+
+    void setZ(int value) {
+        z = value;
+    }
+
+    int x;
+    int y;
+    int z;
+};
+
+class Unregistered {
+public:
+    int x;
+    int y;
+};
+
+static ssq::Class exposeVec(ssq::VM& vm) {
+    ssq::Class cls = vm.addClass("Vec", [](int x, int y) -> Vec* {
+        return new Vec(x, y);
+    });
+    cls.addVar("x", &Vec::x);
+    cls.addVar("y", &Vec::y);
+    // Through bound functions, to compare with the direct access of x and y
+    cls.addVar("z", &Vec::getZ, &Vec::setZ);
+    return cls;
+}
+
+BENCH_CASE("classes/push/by_copy_registered") {
+    ssq::VM vm(1024);
+    exposeVec(vm);
+    HSQUIRRELVM v = vm.getHandle();
+    Vec value(1, 2);
+
+    while (state.keepRunning()) {
+        ssq::detail::pushByCopy(v, value);
+        sq_pop(v, 1);
+    }
+}
+
+BENCH_CASE("classes/push/by_ptr_registered") {
+    ssq::VM vm(1024);
+    exposeVec(vm);
+    HSQUIRRELVM v = vm.getHandle();
+    Vec value(1, 2);
+
+    while (state.keepRunning()) {
+        ssq::detail::pushByPtr(v, &value);
+        sq_pop(v, 1);
+    }
+}
+
+BENCH_CASE("classes/push/by_copy_unregistered") {
+    ssq::VM vm(1024);
+    HSQUIRRELVM v = vm.getHandle();
+    Unregistered value = {1, 2};
+
+    while (state.keepRunning()) {
+        ssq::detail::pushByCopy(v, value);
+        sq_pop(v, 1);
+    }
+}
+
+BENCH_CASE("classes/push/by_ptr_unregistered") {
+    ssq::VM vm(1024);
+    HSQUIRRELVM v = vm.getHandle();
+    Unregistered value = {1, 2};
+
+    while (state.keepRunning()) {
+        ssq::detail::pushByPtr(v, &value);
+        sq_pop(v, 1);
+    }
+}
+
+BENCH_CASE("classes/new_instance") {
+    ssq::VM vm(1024);
+    ssq::Class cls = exposeVec(vm);
+
+    while (state.keepRunning()) {
+        ssq::Instance inst = vm.newInstance(cls, 1, 2);
+        (void)inst;
+    }
+}
+
+static const std::string varSource = STRINGIFY(
+    local vec = Vec(1, 2);
+    function getVar(n) {
+        local sum = 0;
+        for (local i = 0; i < n; i++) {
+            sum += vec.x;
+        }
+        return sum;
+    }
+    function setVar(n) {
+        for (local i = 0; i < n; i++) {
+            vec.x = i;
+        }
+    }
+    function getVarByFunction(n) {
+        local sum = 0;
+        for (local i = 0; i < n; i++) {
+            sum += vec.z;
+        }
+        return sum;
+    }
+    function setVarByFunction(n) {
+        for (local i = 0; i < n; i++) {
+            vec.z = i;
+        }
+    }
+);
+
+static void benchVar(bench::State& state, const char* funcName) {
+    ssq::VM vm(1024);
+    exposeVec(vm);
+
+    ssq::Script script = vm.compileSource(varSource.c_str());
+    vm.run(script);
+    ssq::Function func = vm.findFunc(funcName);
+
+    state.start();
+    vm.callFunc(func, vm, static_cast<int>(state.iterations()));
+    state.stop();
+}
+
+BENCH_CASE("classes/member_var/get") {
+    benchVar(state, "getVar");
+}
+
+BENCH_CASE("classes/member_var/set") {
+    benchVar(state, "setVar");
+}
+
+BENCH_CASE("classes/member_var/get_by_function") {
+    benchVar(state, "getVarByFunction");
+}
+
+BENCH_CASE("classes/member_var/set_by_function") {
+    benchVar(state, "setVarByFunction");
+}
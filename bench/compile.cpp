@@ -0,0 +1,78 @@
+#include "bench.hpp"
+#include <simplesquirrel/simplesquirrel.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <vector>
+
+static const char* sourcePath = "bench_compile.nut";
+
+static std::string makeSource() {
+    std::string source;
+    for (int i = 0; i < 200; i++) {
+        const std::string n = std::to_string(i);
+        source += "function foo" + n + "(a, b) {\n";
+        source += "    local sum = a + b * " + n + ";\n";
+        source += "    for (local i = 0; i < b; i++) { sum += i; }\n";
+        source += "    return sum;\n}\n";
+    }
+    return source;
+}
+
+BENCH_CASE("compile/source/buffer") {
+    ssq::VM vm(1024);
+    const std::string source = makeSource();
+
+    while (state.keepRunning()) {
+        ssq::Script script = vm.compileSource(source.c_str());
+        (void)script;
+    }
+}
+
+BENCH_CASE("compile/source/istream") {
+    ssq::VM vm(1024);
+    const std::string source = makeSource();
+
+    std::vector<std::unique_ptr<std::stringstream>> streams;
+    for (size_t i = 0; i < state.iterations(); i++) {
+        streams.emplace_back(new std::stringstream(source));
+    }
+
+    state.start();
+    for (auto& stream : streams) {
+        ssq::Script script = vm.compileSource(*stream);
+        (void)script;
+    }
+    state.stop();
+}
+
+BENCH_CASE("compile/file") {
+    ssq::VM vm(1024);
+    {
+        std::ofstream file(sourcePath, std::ios::binary);
+        file << makeSource();
+    }
+
+    while (state.keepRunning()) {
+        ssq::Script script = vm.compileFile(sourcePath);
+        (void)script;
+    }
+
+    std::remove(sourcePath);
+}
+
+BENCH_CASE("compile/file_mapped") {
+    ssq::VM vm(1024);
+    {
+        std::ofstream file(sourcePath, std::ios::binary);
+        file << makeSource();
+    }
+
+    while (state.keepRunning()) {
+        ssq::Script script = vm.compileFileMapped(sourcePath);
+        (void)script;
+    }
+
+    std::remove(sourcePath);
+}
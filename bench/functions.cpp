@@ -0,0 +1,169 @@
+#include "bench.hpp"
+#include <simplesquirrel/simplesquirrel.hpp>
+
+#define STRINGIFY(x) #x
+
+static int add3(int a, int b, int c) {
+    return a + b + c;
+}
+
+static const std::string defaultArgsSource = STRINGIFY(
+    function callAll(n) {
+        for (local i = 0; i < n; i++) {
+            add3(1, 2, 3);
+        }
+    }
+    function callDefaults(n) {
+        for (local i = 0; i < n; i++) {
+            add3(1);
+        }
+    }
+);
+
+static void benchDefaultArgs(bench::State& state, const char* funcName) {
+    ssq::VM vm(1024);
+    vm.addFunc("add3", std::function<int(int, int, int)>(&add3), ssq::DefaultArguments<int, int>(2, 3));
+
+    ssq::Script script = vm.compileSource(defaultArgsSource.c_str());
+    vm.run(script);
+    ssq::Function func = vm.findFunc(funcName);
+
+    state.start();
+    vm.callFunc(func, vm, static_cast<int>(state.iterations()));
+    state.stop();
+}
+
+BENCH_CASE("functions/default_args/all_passed") {
+    benchDefaultArgs(state, "callAll");
+}
+
+BENCH_CASE("functions/default_args/defaults_used") {
+    benchDefaultArgs(state, "callDefaults");
+}
+
+static int args0() {
+    return 0;
+}
+
+static int args1(int a) {
+    return a;
+}
+
+static int args4(int a, int b, int c, int d) {
+    return a + b + c + d;
+}
+
+static int args8(int a, int b, int c, int d, int e, int f, int g, int h) {
+    return a + b + c + d + e + f + g + h;
+}
+
+static const std::string nativeCallSource = STRINGIFY(
+    function call0(n) {
+        for (local i = 0; i < n; i++) {
+            args0();
+        }
+    }
+    function call1(n) {
+        for (local i = 0; i < n; i++) {
+            args1(1);
+        }
+    }
+    function call4(n) {
+        for (local i = 0; i < n; i++) {
+            args4(1, 2, 3, 4);
+        }
+    }
+    function call8(n) {
+        for (local i = 0; i < n; i++) {
+            args8(1, 2, 3, 4, 5, 6, 7, 8);
+        }
+    }
+);
+
+static void benchNativeCall(bench::State& state, const char* funcName) {
+    ssq::VM vm(1024);
+    vm.addFunc("args0", std::function<int()>(&args0));
+    vm.addFunc("args1", std::function<int(int)>(&args1));
+    vm.addFunc("args4", std::function<int(int, int, int, int)>(&args4));
+    vm.addFunc("args8", std::function<int(int, int, int, int, int, int, int, int)>(&args8));
+
+    ssq::Script script = vm.compileSource(nativeCallSource.c_str());
+    vm.run(script);
+    ssq::Function func = vm.findFunc(funcName);
+
+    state.start();
+    vm.callFunc(func, vm, static_cast<int>(state.iterations()));
+    state.stop();
+}
+
+BENCH_CASE("functions/script_to_native/0_args") {
+    benchNativeCall(state, "call0");
+}
+
+BENCH_CASE("functions/script_to_native/1_arg") {
+    benchNativeCall(state, "call1");
+}
+
+BENCH_CASE("functions/script_to_native/4_args") {
+    benchNativeCall(state, "call4");
+}
+
+BENCH_CASE("functions/script_to_native/8_args") {
+    benchNativeCall(state, "call8");
+}
+
+static const std::string scriptCallSource = STRINGIFY(
+    function noop() {
+    }
+    function add(a, b) {
+        return a + b;
+    }
+);
+
+BENCH_CASE("functions/native_to_script/0_args") {
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(scriptCallSource.c_str());
+    vm.run(script);
+    ssq::Function func = vm.findFunc("noop");
+
+    while (state.keepRunning()) {
+        vm.callFunc(func, vm);
+    }
+}
+
+BENCH_CASE("functions/native_to_script/2_args") {
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(scriptCallSource.c_str());
+    vm.run(script);
+    ssq::Function func = vm.findFunc("add");
+
+    while (state.keepRunning()) {
+        vm.callFunc(func, vm, 1, 2);
+    }
+}
+
+BENCH_CASE("functions/native_to_script/2_args_typed") {
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(scriptCallSource.c_str());
+    vm.run(script);
+    ssq::Function func = vm.findFunc("add");
+
+    int sum = 0;
+    while (state.keepRunning()) {
+        sum += vm.callFunc<int>(func, vm, 1, 2);
+    }
+    (void)sum;
+}
+
+BENCH_CASE("functions/native_to_script/bound_2_args") {
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(scriptCallSource.c_str());
+    vm.run(script);
+    ssq::BoundCall add(vm.findFunc("add"), vm);
+
+    int sum = 0;
+    while (state.keepRunning()) {
+        sum += add.call<int>(1, 2);
+    }
+    (void)sum;
+}
@@ -0,0 +1,110 @@
+#include "bench.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace bench {
+    std::atomic<size_t> allocations(0);
+}
+
+void* operator new(size_t size) {
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+static const double minTimeNs = 200.0 * 1000.0 * 1000.0;
+static const size_t maxIterations = 1u << 30;
+
+enum class Format {
+    TEXT,
+    CSV,
+    JSON
+};
+
+static void printUsage(const char* name) {
+    std::printf("Usage: %s [--format=text|csv|json] [filter]\n", name);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    Format format = Format::TEXT;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--format=text") == 0) {
+            format = Format::TEXT;
+        } else if (std::strcmp(argv[i], "--format=csv") == 0) {
+            format = Format::CSV;
+        } else if (std::strcmp(argv[i], "--format=json") == 0) {
+            format = Format::JSON;
+        } else if (argv[i][0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    switch (format) {
+        case Format::TEXT:
+            std::printf("%-48s %14s %12s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+            break;
+        case Format::CSV:
+            std::printf("name,iterations,ns_per_op,allocs_per_op\n");
+            break;
+        case Format::JSON:
+            std::printf("{\n  \"benchmarks\": [");
+            break;
+    }
+
+    bool first = true;
+    for (const bench::Case& c : bench::registry()) {
+        if (filter && c.name.find(filter) == std::string::npos) continue;
+
+        size_t iterations = 1;
+        double elapsed = 0.0;
+        size_t allocs = 0;
+        while (true) {
+            bench::State state(iterations);
+            c.func(state);
+            elapsed = state.elapsedNs();
+            allocs = state.allocs();
+            if (elapsed >= minTimeNs || iterations >= maxIterations) break;
+            iterations *= elapsed > minTimeNs / 100.0 ? 2 : 10;
+        }
+
+        const double nsPerOp = elapsed / iterations;
+        const double allocsPerOp = static_cast<double>(allocs) / iterations;
+
+        switch (format) {
+            case Format::TEXT:
+                std::printf("%-48s %14zu %12.2f %12.2f\n", c.name.c_str(), iterations, nsPerOp, allocsPerOp);
+                break;
+            case Format::CSV:
+                std::printf("%s,%zu,%.2f,%.2f\n", c.name.c_str(), iterations, nsPerOp, allocsPerOp);
+                break;
+            case Format::JSON:
+                std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.2f}",
+                    first ? "" : ",", c.name.c_str(), iterations, nsPerOp, allocsPerOp);
+                break;
+        }
+        std::fflush(stdout);
+        first = false;
+    }
+
+    if (format == Format::JSON) {
+        std::printf("\n  ]\n}\n");
+    }
+    return 0;
+}
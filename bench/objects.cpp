@@ -0,0 +1,124 @@
+#include "bench.hpp"
+#include <simplesquirrel/simplesquirrel.hpp>
+
+static const size_t arraySize = 64;
+
+BENCH_CASE("objects/table/find") {
+    ssq::VM vm(1024);
+    ssq::Table table = vm.newTable();
+    table.set("value", 42);
+
+    while (state.keepRunning()) {
+        ssq::Object obj = table.find("value");
+        (void)obj;
+    }
+}
+
+BENCH_CASE("objects/table/find_key") {
+    ssq::VM vm(1024);
+    ssq::Table table = vm.newTable();
+    table.set("value", 42);
+    ssq::Key key = vm.newKey("value");
+
+    while (state.keepRunning()) {
+        ssq::Object obj = table.find(key);
+        (void)obj;
+    }
+}
+
+BENCH_CASE("objects/table/set") {
+    ssq::VM vm(1024);
+    ssq::Table table = vm.newTable();
+    table.set("value", 0);
+
+    int i = 0;
+    while (state.keepRunning()) {
+        table.set("value", i++);
+    }
+}
+
+BENCH_CASE("objects/table/get") {
+    ssq::VM vm(1024);
+    ssq::Table table = vm.newTable();
+    table.set("value", 42);
+
+    int sum = 0;
+    while (state.keepRunning()) {
+        sum += table.get<int>("value");
+    }
+    (void)sum;
+}
+
+BENCH_CASE("objects/table/get_key") {
+    ssq::VM vm(1024);
+    ssq::Table table = vm.newTable();
+    table.set("value", 42);
+    ssq::Key key = vm.newKey("value");
+
+    int sum = 0;
+    while (state.keepRunning()) {
+        sum += table.get<int>(key);
+    }
+    (void)sum;
+}
+
+static ssq::Array makeArray(ssq::VM& vm) {
+    std::vector<int> values(arraySize);
+    for (size_t i = 0; i < arraySize; i++) {
+        values[i] = static_cast<int>(i);
+    }
+    return vm.newArray(values);
+}
+
+BENCH_CASE("objects/array/get") {
+    ssq::VM vm(1024);
+    ssq::Array array = makeArray(vm);
+
+    size_t i = 0;
+    int sum = 0;
+    while (state.keepRunning()) {
+        sum += array.get<int>(i++ % arraySize);
+    }
+    (void)sum;
+}
+
+BENCH_CASE("objects/array/set") {
+    ssq::VM vm(1024);
+    ssq::Array array = makeArray(vm);
+
+    size_t i = 0;
+    while (state.keepRunning()) {
+        array.set(i % arraySize, static_cast<int>(i));
+        i++;
+    }
+}
+
+BENCH_CASE("objects/array/convert_64") {
+    ssq::VM vm(1024);
+    ssq::Array array = makeArray(vm);
+
+    while (state.keepRunning()) {
+        std::vector<int> values = array.convert<int>();
+        (void)values;
+    }
+}
+
+BENCH_CASE("objects/array/read_64") {
+    ssq::VM vm(1024);
+    ssq::Array array = makeArray(vm);
+    std::vector<int> values;
+
+    while (state.keepRunning()) {
+        array.read(values);
+    }
+}
+
+BENCH_CASE("objects/array/append_64") {
+    ssq::VM vm(1024);
+    std::vector<int> values(arraySize);
+
+    while (state.keepRunning()) {
+        ssq::Array array = vm.newArray(values.data(), values.size());
+        (void)array;
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "util.hpp"
+#include "memory.hpp"
 
 namespace ssq {
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -17,25 +18,31 @@ namespace ssq {
             return 0;
         }
 
+        // Releases a copy made by pushByCopy, allocated with construct
+        template<class T>
+        static SQInteger classCopyDestructor(SQUserPointer ptr, SQInteger size) {
+            destroy(static_cast<T*>(ptr));
+            return 0;
+        }
+
         template<class T>
         static SQInteger classPtrDestructor(SQUserPointer ptr, SQInteger size) {
             T** p = static_cast<T**>(ptr);
-            delete *p;
+            destroy(*p);
             return 0;
         }
 
-
         template<class Ret, typename... Args>
         static SQInteger funcReleaseHook(SQUserPointer p, SQInteger size) {
             auto funcPtr = reinterpret_cast<FuncPtr<Ret(Args...)>*>(p);
-            delete funcPtr->ptr;
+            destroy(funcPtr->ptr);
             return 0;
         }
 
         template<typename... Args>
         static SQInteger defaultArgsReleaseHook(SQUserPointer p, SQInteger size) {
             auto defaultArgsPtr = reinterpret_cast<DefaultArgsPtr<Args...>*>(p);
-            delete defaultArgsPtr->ptr;
+            destroy(defaultArgsPtr->ptr);
             return 0;
         }
     }
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "allocators.hpp"
+#include "class_registry.hpp"
 #include "exceptions.hpp"
 #include "exposable_class.hpp"
+#include "string_ref.hpp"
 
 #include <squirrel.h>
 #include <cassert>
@@ -18,8 +20,31 @@ namespace ssq {
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     namespace detail {
-        SSQ_API void addClassObj(size_t hashCode, const HSQOBJECT& obj);
-        SSQ_API const HSQOBJECT& getClassObj(size_t hashCode);
+        SSQ_API void addClassObj(HSQUIRRELVM vm, size_t hashCode, const HSQOBJECT& obj);
+        SSQ_API const HSQOBJECT& getClassObj(HSQUIRRELVM vm, size_t hashCode);
+        SSQ_API const ClassRegistry* getClassRegistry(HSQUIRRELVM vm);
+
+        /**
+        * @brief Returns the class object registered for T* or nullptr, without throwing
+        * @details The slot is resolved once per thread and cached until the registry
+        * of the VM changes.
+        */
+        template<typename T>
+        inline const HSQOBJECT* findClassObj(HSQUIRRELVM vm) {
+            struct Cache {
+                uint64_t generation;
+                const HSQOBJECT* obj;
+            };
+            static thread_local Cache cache = { 0, nullptr };
+
+            const ClassRegistry* registry = getClassRegistry(vm);
+            if (!registry) return nullptr;
+            if (cache.generation != registry->getGeneration()) {
+                cache.obj = registry->find(typeid(T*).hash_code());
+                cache.generation = registry->getGeneration();
+            }
+            return cache.obj;
+        }
 
         inline void checkType(HSQUIRRELVM vm, SQInteger index, SQObjectType expected) {
             auto type = sq_gettype(vm, index);
@@ -50,8 +75,18 @@ namespace ssq {
             return p;
         }
 
+        /* Specialized for Buffer<T> in buffer.hpp, which is passed as a view of C++ memory rather than a copy */
         template<typename T>
-        inline T popValue(HSQUIRRELVM vm, SQInteger index){
+        struct BufferTraits: std::false_type {
+        };
+
+        template<typename T>
+        inline T popCopy(HSQUIRRELVM vm, SQInteger index, std::true_type) {
+            return BufferTraits<T>::pop(vm, index);
+        }
+
+        template<typename T>
+        inline T popCopy(HSQUIRRELVM vm, SQInteger index, std::false_type) {
             const SQObjectType type = sq_gettype(vm, index);
             SQUserPointer ptr;
             if(type == OT_USERDATA) {
@@ -79,6 +114,11 @@ namespace ssq {
             }
         }
 
+        template<typename T>
+        inline T popValue(HSQUIRRELVM vm, SQInteger index){
+            return popCopy<T>(vm, index, BufferTraits<T>());
+        }
+
         template<typename T>
         inline T popPointer(HSQUIRRELVM vm, SQInteger index) {
             const SQObjectType type = sq_gettype(vm, index);
@@ -263,6 +303,23 @@ namespace ssq {
         }
 #endif
 
+        template<>
+        inline StringRef popValue(HSQUIRRELVM vm, SQInteger index){
+            const SQChar* val = nullptr;
+            SQInteger len = 0;
+            if (SQ_FAILED(sq_getstringandsize(vm, index, &val, &len))) {
+                throw TypeException("bad cast", "STRING", typeToStr(Type(sq_gettype(vm, index))));
+            }
+            return StringRef(val, static_cast<size_t>(len));
+        }
+
+#ifdef SSQ_CXX17
+        template<>
+        inline std::basic_string_view<SQChar> popValue(HSQUIRRELVM vm, SQInteger index){
+            return popValue<StringRef>(vm, index);
+        }
+#endif
+
         template<typename T>
         inline typename std::enable_if<!std::is_pointer<T>::value, T>::type
         pop(HSQUIRRELVM vm, SQInteger index) {
@@ -271,18 +328,18 @@ namespace ssq {
 
         template<int defaultIndex, typename T, typename... Args>
         inline typename std::enable_if<!std::is_pointer<T>::value && (defaultIndex < 0), T>::type
-        pop(HSQUIRRELVM vm, SQInteger index, const DefaultArgumentsImpl<Args...>&) {
+        pop(HSQUIRRELVM vm, SQInteger index, SQInteger, const DefaultArgumentsImpl<Args...>&) {
             return popValue<typename std::remove_cv<T>::type>(vm, index);
         }
 
+        /* The default is used if the argument has not been passed, i.e. it lies above the stack top */
         template<int defaultIndex, typename T, typename... Args>
         inline typename std::enable_if<!std::is_pointer<T>::value && (defaultIndex >= 0), T>::type
-        pop(HSQUIRRELVM vm, SQInteger index, const DefaultArgumentsImpl<Args...>& defaultArgs) {
-            try {
-                return popValue<typename std::remove_cv<T>::type>(vm, index);
-            } catch (const TypeException&) {
+        pop(HSQUIRRELVM vm, SQInteger index, SQInteger top, const DefaultArgumentsImpl<Args...>& defaultArgs) {
+            if (index > top) {
                 return std::get<defaultIndex>(defaultArgs);
             }
+            return popValue<typename std::remove_cv<T>::type>(vm, index);
         }
 
         template<typename T>
@@ -293,40 +350,50 @@ namespace ssq {
 
         template<int defaultIndex, typename T, typename... Args>
         inline typename std::enable_if<std::is_pointer<T>::value && (defaultIndex < 0), T>::type
-        pop(HSQUIRRELVM vm, SQInteger index, const DefaultArgumentsImpl<Args...>&) {
+        pop(HSQUIRRELVM vm, SQInteger index, SQInteger, const DefaultArgumentsImpl<Args...>&) {
             return popPointer<T>(vm, index);
         }
 
         template<int defaultIndex, typename T, typename... Args>
         inline typename std::enable_if<std::is_pointer<T>::value && (defaultIndex >= 0), T>::type
-        pop(HSQUIRRELVM, SQInteger, const DefaultArgumentsImpl<Args...>&) = delete;
+        pop(HSQUIRRELVM, SQInteger, SQInteger, const DefaultArgumentsImpl<Args...>&) = delete;
 
 
         template<typename T>
         inline void pushByCopy(HSQUIRRELVM vm, const T& value) {
             static const auto hashCode = typeid(T*).hash_code();
-            try {
-                sq_pushobject(vm, getClassObj(hashCode));
+            const HSQOBJECT* classObj = findClassObj<T>(vm);
+            if (classObj) {
+                sq_pushobject(vm, *classObj);
                 sq_createinstance(vm, -1);
                 sq_remove(vm, -2);
 
-                sq_setinstanceup(vm, -1, reinterpret_cast<SQUserPointer>(new T(value)));
+                sq_setinstanceup(vm, -1, reinterpret_cast<SQUserPointer>(construct<T>(vm, value)));
                 sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
-                sq_setreleasehook(vm, -1, classDestructor<T>);
-            } catch (std::out_of_range& e) {
-                (void)e;
+                sq_setreleasehook(vm, -1, classCopyDestructor<T>);
+            } else {
                 T** data = reinterpret_cast<T**>(sq_newuserdata(vm, sizeof(T*)));
-                *data = new T(value);
+                *data = construct<T>(vm, value);
                 sq_setreleasehook(vm, -1, classPtrDestructor<T>);
                 sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(typeid(T).hash_code()));
             }
         }
 
         template<typename T>
-        inline void pushValue(HSQUIRRELVM vm, const T& value){
+        inline void pushCopy(HSQUIRRELVM vm, const T& value, std::true_type) {
+            BufferTraits<T>::push(vm, value);
+        }
+
+        template<typename T>
+        inline void pushCopy(HSQUIRRELVM vm, const T& value, std::false_type) {
             pushByCopy<T>(vm, value);
         }
 
+        template<typename T>
+        inline void pushValue(HSQUIRRELVM vm, const T& value){
+            pushCopy<T>(vm, value, BufferTraits<T>());
+        }
+
         SSQ_API void pushRaw(HSQUIRRELVM vm, const Object& value);
         SSQ_API void pushRaw(HSQUIRRELVM vm, const Class& value);
         SSQ_API void pushRaw(HSQUIRRELVM vm, const Instance& value);
@@ -473,6 +540,18 @@ namespace ssq {
         }
 #endif
 
+        template<>
+        inline void pushValue(HSQUIRRELVM vm, const StringRef& value) {
+            sq_pushstring(vm, value.data(), value.size());
+        }
+
+#ifdef SSQ_CXX17
+        template<>
+        inline void pushValue(HSQUIRRELVM vm, const std::basic_string_view<SQChar>& value) {
+            sq_pushstring(vm, value.data(), value.size());
+        }
+#endif
+
         template<typename T>
         inline void pushByPtr(HSQUIRRELVM vm, T* value) {
             static const auto hashCode = typeid(T*).hash_code();
@@ -480,15 +559,15 @@ namespace ssq {
                 sq_pushnull(vm);
             }
             else {
-                try {
-                    sq_pushobject(vm, getClassObj(hashCode));
+                const HSQOBJECT* classObj = findClassObj<T>(vm);
+                if (classObj) {
+                    sq_pushobject(vm, *classObj);
                     sq_createinstance(vm, -1);
                     sq_remove(vm, -2);
                     sq_setinstanceup(vm, -1, reinterpret_cast<SQUserPointer>(value));
                     sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
                 }
-                catch (std::out_of_range& e) {
-                    (void)e;
+                else {
                     sq_pushuserpointer(vm, reinterpret_cast<SQUserPointer>(value));
                 }
             }
@@ -3,9 +3,53 @@
 #include "object.hpp"
 #include "args.hpp"
 #include <squirrel.h>
+#include <algorithm>
+#include <type_traits>
 #include <vector>
 
 namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Element access for bulk reads and writes, the getter is the only type check
+        template<typename T> inline typename std::enable_if<std::is_same<T, bool>::value, T>::type
+        readElement(HSQUIRRELVM vm, SQInteger index) {
+            SQBool val;
+            if (SQ_FAILED(sq_getbool(vm, index, &val))) {
+                throw TypeException("bad cast", "BOOL", typeToStr(Type(sq_gettype(vm, index))));
+            }
+            return val != 0;
+        }
+        template<typename T> inline typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, T>::type
+        readElement(HSQUIRRELVM vm, SQInteger index) {
+            SQInteger val;
+            if (SQ_FAILED(sq_getinteger(vm, index, &val))) {
+                throw TypeException("bad cast", "BOOL|INTEGER|FLOAT", typeToStr(Type(sq_gettype(vm, index))));
+            }
+            return static_cast<T>(val);
+        }
+        template<typename T> inline typename std::enable_if<std::is_floating_point<T>::value, T>::type
+        readElement(HSQUIRRELVM vm, SQInteger index) {
+            SQFloat val;
+            if (SQ_FAILED(sq_getfloat(vm, index, &val))) {
+                throw TypeException("bad cast", "INTEGER|FLOAT", typeToStr(Type(sq_gettype(vm, index))));
+            }
+            return static_cast<T>(val);
+        }
+
+        inline void writeElement(HSQUIRRELVM vm, bool value) {
+            sq_pushbool(vm, value);
+        }
+        template<typename T> inline typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type
+        writeElement(HSQUIRRELVM vm, T value) {
+            sq_pushinteger(vm, static_cast<SQInteger>(value));
+        }
+        template<typename T> inline typename std::enable_if<std::is_floating_point<T>::value>::type
+        writeElement(HSQUIRRELVM vm, T value) {
+            sq_pushfloat(vm, static_cast<SQFloat>(value));
+        }
+    }
+#endif
+
     /**
     * @brief Squirrel intance of array object
     * @ingroup simplesquirrel
@@ -25,6 +69,7 @@ namespace ssq {
         */
         template<typename T>
         Array(HSQUIRRELVM vm_, const std::vector<T>& vector):Object(vm_) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_newarray(vm, 0);
             sq_getstackobj(vm, -1, &obj);
             sq_addref(vm, &obj);
@@ -40,6 +85,19 @@ namespace ssq {
             sq_pop(vm, 1); // Pop array
         }
         /**
+        * @brief Constructs array out of contiguous numbers or bools
+        * @see append
+        */
+        template<typename T>
+        Array(HSQUIRRELVM vm_, const T* data, size_t count):Object(vm_) {
+            detail::ObjectAllocatorScope scope(vm);
+            sq_newarray(vm, 0);
+            sq_getstackobj(vm, -1, &obj);
+            sq_addref(vm, &obj);
+            sq_pop(vm, 1);
+            append(data, count);
+        }
+        /**
         * @brief Converts Object to Array
         * @throws TypeException if the Object is not type of an array
         */
@@ -61,6 +119,7 @@ namespace ssq {
         */
         template<typename T>
         void push(const T& value) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_pushobject(vm, obj);
             detail::push(vm, value);
             if(SQ_FAILED(sq_arrayappend(vm, -2))) {
@@ -74,6 +133,7 @@ namespace ssq {
         */
         template<typename T>
         T popAndGet() {
+            static_assert(!detail::is_string_view<T>::value, "A string view cannot outlive the call it's passed to, use std::string");
             sq_pushobject(vm, obj);
             auto s = sq_getsize(vm, -1);
             if(s == 0) {
@@ -108,6 +168,7 @@ namespace ssq {
         */
         template<typename T>
         T get(size_t index) {
+            static_assert(!detail::is_string_view<T>::value, "A string view cannot outlive the call it's passed to, use std::string");
             sq_pushobject(vm, obj);
             auto s = static_cast<size_t>(sq_getsize(vm, -1));
             if(index >= s) {
@@ -152,6 +213,7 @@ namespace ssq {
         */
         template<typename T>
         void set(size_t index, const T& value) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_pushobject(vm, obj);
             auto s = static_cast<size_t>(sq_getsize(vm, -1));
             if(index >= s) {
@@ -172,9 +234,102 @@ namespace ssq {
         std::vector<Object> convertRaw() const;
         /**
          * @brief Converts this array to std::vector of specific type T
+         * @details Arrays of numbers are converted with read()
          */
         template<typename T>
         std::vector<T> convert() const {
+            static_assert(!detail::is_string_view<T>::value, "A string view cannot outlive the call it's passed to, use std::string");
+            return convertImpl<T>(std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>());
+        }
+        /**
+        * @brief Copies a range of elements into a buffer of numbers or bools
+        * @details Each element is fetched by its index into the same stack slot and
+        * read with a single type check, without iterating over the elements before
+        * the range. Integers accept bools, integers and floats, floating point
+        * numbers accept integers and floats, bools accept only bools.
+        * @param buffer Receives at most count elements
+        * @param count The maximum number of elements to copy
+        * @param offset The index of the first element to copy
+        * @returns The number of elements copied, less than count if the array is shorter
+        * @throws TypeException if an element cannot be converted to T, the buffer
+        * is then partially filled
+        */
+        template<typename T>
+        size_t read(T* buffer, size_t count, size_t offset = 0) const {
+            static_assert(std::is_arithmetic<T>::value, "Only numbers and bools can be read in bulk");
+            sq_pushobject(vm, obj);
+            const size_t s = static_cast<size_t>(sq_getsize(vm, -1));
+            if (offset >= s) {
+                sq_pop(vm, 1);
+                return 0;
+            }
+            count = std::min(count, s - offset);
+
+            try {
+                for (size_t i = 0; i < count; i++) {
+                    sq_pushinteger(vm, static_cast<SQInteger>(offset + i));
+                    sq_rawget(vm, -2);
+                    buffer[i] = detail::readElement<T>(vm, -1);
+                    sq_pop(vm, 1);
+                }
+            } catch (...) {
+                sq_pop(vm, 2);
+                throw;
+            }
+
+            sq_pop(vm, 1);
+            return count;
+        }
+        /**
+        * @brief Replaces the contents of a std::vector with all elements of this array
+        * @see read
+        */
+        template<typename T>
+        void read(std::vector<T>& vector) const {
+            static_assert(!std::is_same<T, bool>::value, "std::vector<bool> has no contiguous storage");
+            sq_pushobject(vm, obj);
+            vector.resize(static_cast<size_t>(sq_getsize(vm, -1)));
+            sq_pop(vm, 1);
+            if (!vector.empty()) {
+                read(vector.data(), vector.size());
+            }
+        }
+        /**
+        * @brief Appends contiguous numbers or bools to the back of the array
+        * @details Each value is pushed straight to the stack as a Squirrel integer,
+        * float or bool, without going through the generic conversion of push().
+        */
+        template<typename T>
+        void append(const T* data, size_t count) {
+            static_assert(std::is_arithmetic<T>::value, "Only numbers and bools can be appended in bulk");
+            detail::ObjectAllocatorScope scope(vm);
+            sq_pushobject(vm, obj);
+            for (size_t i = 0; i < count; i++) {
+                detail::writeElement(vm, data[i]);
+                if(SQ_FAILED(sq_arrayappend(vm, -2))) {
+                    sq_pop(vm, 2);
+                    throw RuntimeException(vm, "Failed to push value to the back of array!");
+                }
+            }
+            sq_pop(vm, 1);
+        }
+        /**
+        * @brief Copy assingment operator
+        */ 
+        Array& operator = (const Array& other);
+        /**
+        * @brief Move assingment operator
+        */
+        Array& operator = (Array&& other) NOEXCEPT;
+    private:
+        template<typename T>
+        std::vector<T> convertImpl(std::true_type) const {
+            std::vector<T> ret;
+            read(ret);
+            return ret;
+        }
+        template<typename T>
+        std::vector<T> convertImpl(std::false_type) const {
             const SQInteger old_top = sq_gettop(vm);
             sq_pushobject(vm, obj);
             size_t s = static_cast<size_t>(sq_getsize(vm, -1));
@@ -194,14 +349,6 @@ namespace ssq {
             sq_settop(vm, old_top);
             return ret;
         }
-        /**
-        * @brief Copy assingment operator
-        */ 
-        Array& operator = (const Array& other);
-        /**
-        * @brief Move assingment operator
-        */
-        Array& operator = (Array&& other) NOEXCEPT;
     };
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     namespace detail {
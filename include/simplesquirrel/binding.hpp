@@ -1,11 +1,14 @@
 #pragma once
 
 #include "args.hpp"
+#include "interrupt.hpp"
+#include "native_stats.hpp"
 
 #include <cassert>
 #include <functional>
 #include <cstring>
 #include <string>
+#include <vector>
 
 namespace ssq {
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -32,6 +35,10 @@ namespace ssq {
         template <> struct Param<std::wstring> {static const char type = 's';};
 #else
         template <> struct Param<std::string> {static const char type = 's';};
+#endif
+        template <> struct Param<StringRef> {static const char type = 's';};
+#ifdef SSQ_CXX17
+        template <> struct Param<std::basic_string_view<SQChar>> {static const char type = 's';};
 #endif
         template <> struct Param<Class> {static const char type = 'y';};
         template <> struct Param<Function> {static const char type = 'c';};
@@ -51,11 +58,31 @@ namespace ssq {
             (void)_; // Fix unused parameter warning.
         }
 
+        /* The type tag of the class a parameter takes, by pointer or by value, or 0 if it takes no exposed class */
+        template <typename A>
+        static size_t paramTag() {
+            typedef typename std::remove_cv<typename std::remove_pointer<
+                typename std::remove_cv<typename std::remove_reference<A>::type>::type>::type>::type T;
+            return std::is_class<T>::value && !std::is_base_of<Object, T>::value ? typeid(T*).hash_code() : 0;
+        }
+
+        template <typename ...B>
+        static void paramTagPacker(std::vector<size_t>& tags) {
+            int _[] = { 0, (tags.push_back(paramTag<B>()), 0)... };
+            (void)_; // Fix unused parameter warning.
+        }
+
 
+        /* The name is what calls are counted under with SSQ_NATIVE_PROFILER */
         template<typename Ret, typename... Args>
-        static void bindUserData(HSQUIRRELVM vm, const std::function<Ret(Args...)>& func) {
+        static void bindUserData(HSQUIRRELVM vm, const std::function<Ret(Args...)>& func, const char* name) {
             auto funcStruct = reinterpret_cast<detail::FuncPtr<Ret(Args...)>*>(sq_newuserdata(vm, sizeof(detail::FuncPtr<Ret(Args...)>)));
-            funcStruct->ptr = new std::function<Ret(Args...)>(func);
+            funcStruct->ptr = detail::construct<std::function<Ret(Args...)>>(vm, func);
+#ifdef SSQ_NATIVE_PROFILER
+            funcStruct->counters = getNativeCallCounters(vm, name);
+#else
+            (void)name;
+#endif
             sq_setreleasehook(vm, -1, &detail::funcReleaseHook<Ret, Args...>);
         }
 
@@ -67,7 +94,7 @@ namespace ssq {
         static typename std::enable_if<(sizeof...(Args) > 0), void>::type
         bindUserData(HSQUIRRELVM vm, DefaultArgumentsImpl<Args...> defaultArgs) {
             auto defaultArgsStruct = reinterpret_cast<detail::DefaultArgsPtr<Args...>*>(sq_newuserdata(vm, sizeof(detail::DefaultArgsPtr<Args...>)));
-            defaultArgsStruct->ptr = new DefaultArguments<Args...>(std::move(defaultArgs));
+            defaultArgsStruct->ptr = detail::construct<DefaultArguments<Args...>>(vm, std::move(defaultArgs));
             sq_setreleasehook(vm, -1, &detail::defaultArgsReleaseHook<Args...>);
         }
 
@@ -80,14 +107,16 @@ namespace ssq {
 
         template<class Ret, class... Args, class... DefaultArgs, int... Is, int... DefIs>
         static inline Ret callFuncImpl(HSQUIRRELVM vm, const std::function<Ret(Args...)>* func, const DefaultArgumentsImpl<DefaultArgs...>& defaultArgs,
-                                       index_list<Is...>, index_list<DefIs...>) {
+                                       SQInteger top, index_list<Is...>, index_list<DefIs...>) {
             (void)vm; // Fix unused parameter warning.
-            return func->operator()(detail::pop<DefIs, typename std::remove_reference<Args>::type>(vm, Is + 1, defaultArgs)...);
+            (void)top;
+            return func->operator()(detail::pop<DefIs, typename std::remove_reference<Args>::type>(vm, Is + 1, top, defaultArgs)...);
         }
 
         template<int offset, class... DefaultArgs, class Ret, class... Args>
         static inline typename std::enable_if<!sizeof...(DefaultArgs), Ret>::type
         callFunc(HSQUIRRELVM vm, FuncPtr<Ret(Args...)>* funcPtr) {
+            checkInterrupt(vm);
             return callFuncImpl(vm, funcPtr->ptr,
                     index_range<offset, sizeof...(Args) + offset>());
         }
@@ -95,6 +124,7 @@ namespace ssq {
         template<int offset, class... DefaultArgs, class Ret, class... Args>
         static inline typename std::enable_if<(sizeof...(DefaultArgs) > 0), Ret>::type
         callFunc(HSQUIRRELVM vm, FuncPtr<Ret(Args...)>* funcPtr) {
+            checkInterrupt(vm);
             constexpr int nparams = sizeof...(Args);
             constexpr int ndefparams = sizeof...(DefaultArgs);
 
@@ -102,7 +132,8 @@ namespace ssq {
             sq_getuserdata(vm, -1, reinterpret_cast<void**>(&defaultArgsPtr), nullptr);
             sq_pop(vm, 1);
 
-            return callFuncImpl(vm, funcPtr->ptr, *defaultArgsPtr->ptr,
+            // Only the passed arguments are on the stack now
+            return callFuncImpl(vm, funcPtr->ptr, *defaultArgsPtr->ptr, sq_gettop(vm),
                     index_range<offset, nparams + offset>(),
                     index_range<ndefparams - nparams, ndefparams>());
         }
@@ -114,10 +145,12 @@ namespace ssq {
         template<class T, class... Args, class... DefaultArgs>
         struct classAllocatorBinding<T, DefaultArgumentsImpl<DefaultArgs...>, Args...> {
             static SQInteger call(HSQUIRRELVM vm) {
+                NativeCallScope scope;
                 try {
                     FuncPtr<T*(Args...)>* funcPtr;
                     sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
                     sq_pop(vm, 1);
+                    scope.start(funcPtr);
 
                     T* p = detail::callFunc<1, DefaultArgs...>(vm, funcPtr);
                     sq_setinstanceup(vm, 1, p);
@@ -129,6 +162,7 @@ namespace ssq {
 
                     return sizeof...(Args);
                 } catch (const std::exception& e) {
+                    scope.fail();
                     return sq_throwerror(vm, e.what());
                 }
             }
@@ -140,10 +174,12 @@ namespace ssq {
         template<class T, class... Args, class... DefaultArgs>
         struct classAllocatorNoReleaseBinding<T, DefaultArgumentsImpl<DefaultArgs...>, Args...> {
             static SQInteger call(HSQUIRRELVM vm) {
+                NativeCallScope scope;
                 try {
                     FuncPtr<T*(Args...)>* funcPtr;
                     sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
                     sq_pop(vm, 1);
+                    scope.start(funcPtr);
 
                     T* p = detail::callFunc<1, DefaultArgs...>(vm, funcPtr);
                     sq_setinstanceup(vm, 1, p);
@@ -154,6 +190,7 @@ namespace ssq {
 
                     return sizeof...(Args);
                 } catch (const std::exception& e) {
+                    scope.fail();
                     return sq_throwerror(vm, e.what());
                 }
             }
@@ -166,14 +203,17 @@ namespace ssq {
         template<int offset, typename R, typename... Args, typename... DefaultArgs>
         struct funcBinding<offset, R, DefaultArgumentsImpl<DefaultArgs...>, Args...> {
             static SQInteger call(HSQUIRRELVM vm) {
+                NativeCallScope scope;
                 try {
                     FuncPtr<R(Args...)>* funcPtr;
                     sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
                     sq_pop(vm, 1);
+                    scope.start(funcPtr);
 
                     push(vm, std::forward<R>(detail::callFunc<offset, DefaultArgs...>(vm, funcPtr)));
                     return 1;
                 } catch (const std::exception& e) {
+                    scope.fail();
                     return sq_throwerror(vm, e.what());
                 }
             }
@@ -181,14 +221,17 @@ namespace ssq {
         template<int offset, typename R, typename... Args, typename... DefaultArgs>
         struct funcBinding<offset, std::vector<R>, DefaultArgumentsImpl<DefaultArgs...>, Args...> {
             static SQInteger call(HSQUIRRELVM vm) {
+                NativeCallScope scope;
                 try {
                     FuncPtr<std::vector<R>(Args...)>* funcPtr;
                     sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
                     sq_pop(vm, 1);
+                    scope.start(funcPtr);
 
                     push(vm, std::forward<std::vector<R>>(detail::callFunc<offset, DefaultArgs...>(vm, funcPtr)));
                     return 1;
                 } catch (const std::exception& e) {
+                    scope.fail();
                     return sq_throwerror(vm, e.what());
                 }
             }
@@ -197,14 +240,17 @@ namespace ssq {
         template<int offset, typename... Args, typename... DefaultArgs>
         struct funcBinding<offset, void, DefaultArgumentsImpl<DefaultArgs...>, Args...> {
             static SQInteger call(HSQUIRRELVM vm) {
+                NativeCallScope scope;
                 try {
                     FuncPtr<void(Args...)>* funcPtr;
                     sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
                     sq_pop(vm, 1);
+                    scope.start(funcPtr);
 
                     detail::callFunc<offset, DefaultArgs...>(vm, funcPtr);
                     return 0;
                 } catch (const std::exception& e) {
+                    scope.fail();
                     return sq_throwerror(vm, e.what());
                 }
             }
@@ -213,19 +259,218 @@ namespace ssq {
         template<int offset, typename... Args, typename... DefaultArgs>
         struct funcBinding<offset, SQInteger, DefaultArgumentsImpl<DefaultArgs...>, Args...> {
             static SQInteger call(HSQUIRRELVM vm) {
+                NativeCallScope scope;
                 try {
                     FuncPtr<SQInteger(Args...)>* funcPtr;
                     sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
                     sq_pop(vm, 1);
+                    scope.start(funcPtr);
 
                     return detail::callFunc<offset, DefaultArgs...>(vm, funcPtr);
                 } catch (const std::exception& e) {
+                    scope.fail();
                     return sq_throwerror(vm, e.what());
                 }
             }
         };
 
 
+        /* Function pointers known at compile time, called directly by the trampoline */
+        template<typename F, F func>
+        struct StaticFunc;
+
+        template<typename R, typename... Args, R(*func)(Args...)>
+        struct StaticFunc<R(*)(Args...), func> {
+            typedef R Return;
+            typedef R Signature(Args...);
+            static const bool withVM = false;
+            static const std::size_t nparams = sizeof...(Args);
+            static void paramTypes(std::string& str) {
+                paramPacker<Args...>(str);
+            }
+            static inline R invoke(Args... args) {
+                return func(std::forward<Args>(args)...);
+            }
+        };
+
+        template<typename R, typename... Args, R(*func)(HSQUIRRELVM, Args...)>
+        struct StaticFunc<R(*)(HSQUIRRELVM, Args...), func> {
+            typedef R Return;
+            typedef R Signature(HSQUIRRELVM, Args...);
+            static const bool withVM = true;
+            static const std::size_t nparams = sizeof...(Args);
+            static void paramTypes(std::string& str) {
+                paramPacker<Args...>(str);
+            }
+            static inline R invoke(HSQUIRRELVM vm, Args... args) {
+                return func(vm, std::forward<Args>(args)...);
+            }
+        };
+
+        template<typename R, typename T, typename... Args, R(T::*func)(Args...)>
+        struct StaticFunc<R(T::*)(Args...), func> {
+            typedef R Return;
+            typedef R Signature(T*, Args...);
+            static const bool withVM = false;
+            static const std::size_t nparams = sizeof...(Args) + 1;
+            static void paramTypes(std::string& str) {
+                paramPacker<T*, Args...>(str);
+            }
+            static inline R invoke(T* self, Args... args) {
+                return (self->*func)(std::forward<Args>(args)...);
+            }
+        };
+
+        template<typename R, typename T, typename... Args, R(T::*func)(Args...) const>
+        struct StaticFunc<R(T::*)(Args...) const, func> {
+            typedef R Return;
+            typedef R Signature(T*, Args...);
+            static const bool withVM = false;
+            static const std::size_t nparams = sizeof...(Args) + 1;
+            static void paramTypes(std::string& str) {
+                paramPacker<T*, Args...>(str);
+            }
+            static inline R invoke(T* self, Args... args) {
+                return (self->*func)(std::forward<Args>(args)...);
+            }
+        };
+
+        template<typename R, typename T, typename... Args, R(T::*func)(HSQUIRRELVM, Args...)>
+        struct StaticFunc<R(T::*)(HSQUIRRELVM, Args...), func> {
+            typedef R Return;
+            typedef R Signature(HSQUIRRELVM, T*, Args...);
+            static const bool withVM = true;
+            static const std::size_t nparams = sizeof...(Args) + 1;
+            static void paramTypes(std::string& str) {
+                paramPacker<T*, Args...>(str);
+            }
+            static inline R invoke(HSQUIRRELVM vm, T* self, Args... args) {
+                return (self->*func)(vm, std::forward<Args>(args)...);
+            }
+        };
+
+        template<typename R, typename T, typename... Args, R(T::*func)(HSQUIRRELVM, Args...) const>
+        struct StaticFunc<R(T::*)(HSQUIRRELVM, Args...) const, func> {
+            typedef R Return;
+            typedef R Signature(HSQUIRRELVM, T*, Args...);
+            static const bool withVM = true;
+            static const std::size_t nparams = sizeof...(Args) + 1;
+            static void paramTypes(std::string& str) {
+                paramPacker<T*, Args...>(str);
+            }
+            static inline R invoke(HSQUIRRELVM vm, T* self, Args... args) {
+                return (self->*func)(vm, std::forward<Args>(args)...);
+            }
+        };
+
+        template<class Func, class Signature>
+        struct staticCall;
+
+        template<class Func, class Ret, class... Args>
+        struct staticCall<Func, Ret(Args...)> {
+            template<int... Is>
+            static inline Ret callImpl(HSQUIRRELVM vm, index_list<Is...>) {
+                (void)vm; // Fix unused parameter warning.
+                return Func::invoke(detail::pop<typename std::remove_reference<Args>::type>(vm, Is + 1)...);
+            }
+
+            template<class... DefaultArgs, int... Is, int... DefIs>
+            static inline Ret callImpl(HSQUIRRELVM vm, const DefaultArgumentsImpl<DefaultArgs...>& defaultArgs,
+                                       SQInteger top, index_list<Is...>, index_list<DefIs...>) {
+                (void)vm; // Fix unused parameter warning.
+                (void)top;
+                return Func::invoke(detail::pop<DefIs, typename std::remove_reference<Args>::type>(vm, Is + 1, top, defaultArgs)...);
+            }
+
+            template<int offset, class... DefaultArgs>
+            static inline typename std::enable_if<!sizeof...(DefaultArgs), Ret>::type
+            call(HSQUIRRELVM vm) {
+                checkInterrupt(vm);
+                return callImpl(vm, index_range<offset, sizeof...(Args) + offset>());
+            }
+
+            template<int offset, class... DefaultArgs>
+            static inline typename std::enable_if<(sizeof...(DefaultArgs) > 0), Ret>::type
+            call(HSQUIRRELVM vm) {
+                checkInterrupt(vm);
+                constexpr int nparams = sizeof...(Args);
+                constexpr int ndefparams = sizeof...(DefaultArgs);
+
+                DefaultArgsPtr<DefaultArgs...>* defaultArgsPtr;
+                sq_getuserdata(vm, -1, reinterpret_cast<void**>(&defaultArgsPtr), nullptr);
+                sq_pop(vm, 1);
+
+                return callImpl(vm, *defaultArgsPtr->ptr, sq_gettop(vm),
+                        index_range<offset, nparams + offset>(),
+                        index_range<ndefparams - nparams, ndefparams>());
+            }
+        };
+
+        template<int offset, typename Func, typename DefaultArgs, typename R = typename Func::Return>
+        struct staticFuncBinding;
+
+        /* Functions with return values */
+        template<int offset, typename Func, typename... DefaultArgs, typename R>
+        struct staticFuncBinding<offset, Func, DefaultArgumentsImpl<DefaultArgs...>, R> {
+            static SQInteger call(HSQUIRRELVM vm) {
+                try {
+                    push(vm, std::forward<R>(staticCall<Func, typename Func::Signature>::template call<offset, DefaultArgs...>(vm)));
+                    return 1;
+                } catch (const std::exception& e) {
+                    return sq_throwerror(vm, e.what());
+                }
+            }
+        };
+        /* Function without a return value */
+        template<int offset, typename Func, typename... DefaultArgs>
+        struct staticFuncBinding<offset, Func, DefaultArgumentsImpl<DefaultArgs...>, void> {
+            static SQInteger call(HSQUIRRELVM vm) {
+                try {
+                    staticCall<Func, typename Func::Signature>::template call<offset, DefaultArgs...>(vm);
+                    return 0;
+                } catch (const std::exception& e) {
+                    return sq_throwerror(vm, e.what());
+                }
+            }
+        };
+        /* Function with a return value, signifying whether it has pushed returned data to the Squirrel stack */
+        template<int offset, typename Func, typename... DefaultArgs>
+        struct staticFuncBinding<offset, Func, DefaultArgumentsImpl<DefaultArgs...>, SQInteger> {
+            static SQInteger call(HSQUIRRELVM vm) {
+                try {
+                    return staticCall<Func, typename Func::Signature>::template call<offset, DefaultArgs...>(vm);
+                } catch (const std::exception& e) {
+                    return sq_throwerror(vm, e.what());
+                }
+            }
+        };
+
+
+        template<typename T>
+        struct ClassCopierImpl {
+            static void* copy(const void* ptr) {
+                return new T(*static_cast<const T*>(ptr));
+            }
+            static void destroy(void* ptr) {
+                delete static_cast<T*>(ptr);
+            }
+            static void push(HSQUIRRELVM vm, const void* ptr) {
+                pushByCopy<T>(vm, *static_cast<const T*>(ptr));
+            }
+        };
+
+        template<typename T>
+        inline typename std::enable_if<std::is_copy_constructible<T>::value>::type registerClassCopier(size_t hashCode) {
+            static const ClassCopier copier = {
+                &ClassCopierImpl<T>::copy, &ClassCopierImpl<T>::destroy, &ClassCopierImpl<T>::push
+            };
+            addClassCopier(hashCode, copier);
+        }
+
+        template<typename T>
+        inline typename std::enable_if<!std::is_copy_constructible<T>::value>::type registerClassCopier(size_t) {
+        }
+
         template<typename T, typename... Args, typename... DefaultArgs>
         static Object addClass(HSQUIRRELVM vm, const char* name, const std::function<T*(Args...)>& allocator,
                                DefaultArgumentsImpl<DefaultArgs...> defaultArgs, HSQOBJECT& base, bool release = true) {
@@ -250,7 +495,8 @@ namespace ssq {
 
             HSQOBJECT obj;
             sq_getstackobj(vm, -1, &obj);
-            addClassObj(hashCode, obj);
+            addClassObj(vm, hashCode, obj);
+            registerClassCopier<T>(hashCode);
 
             sq_getstackobj(vm, -1, &clsObj.getRaw());
             sq_addref(vm, &clsObj.getRaw());
@@ -258,7 +504,7 @@ namespace ssq {
             sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
 
             sq_pushstring(vm, "constructor", -1);
-            bindUserData<T*>(vm, allocator);
+            bindUserData<T*>(vm, allocator, name);
             bindUserData(vm, std::move(defaultArgs));
 
             std::string params;
@@ -305,7 +551,7 @@ namespace ssq {
 
             HSQOBJECT obj;
             sq_getstackobj(vm, -1, &obj);
-            addClassObj(hashCode, obj);
+            addClassObj(vm, hashCode, obj);
 
             sq_getstackobj(vm, -1, &clsObj.getRaw());
             sq_addref(vm, &clsObj.getRaw());
@@ -321,83 +567,164 @@ namespace ssq {
         }
 
 
+        /* A bound native function, its free variables are on the top of the stack */
+        struct NativeBinding {
+            SQFUNCTION func;
+            SQInteger nfreevars;
+            SQInteger minParams;
+            SQInteger maxParams;
+            std::string typemask;
+            // Type tags of the classes the parameters take, see paramTag, empty if not collected
+            std::vector<size_t> paramTags;
+        };
+
+        /* Creates the closure of the binding from its free variables on the stack */
+        inline void newNativeClosure(HSQUIRRELVM vm, const NativeBinding& binding) {
+            sq_newclosure(vm, binding.func, binding.nfreevars);
+            sq_setparamscheck(vm, binding.minParams, binding.maxParams, binding.typemask.c_str());
+        }
+
         template<typename R, typename... Args, typename... DefaultArgs>
-        static void addFunc(HSQUIRRELVM vm, const char* name, const std::function<R(Args...)>& func,
-                            DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
+        static NativeBinding bindFunc(HSQUIRRELVM vm, const char* name, const std::function<R(Args...)>& func,
+                                      DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
             constexpr std::size_t nparams = sizeof...(Args);
             constexpr std::size_t ndefparams = sizeof...(DefaultArgs);
 
-            sq_pushstring(vm, name, strlen(name));
-
-            bindUserData(vm, func);
+            bindUserData(vm, func, name);
             bindUserData(vm, std::move(defaultArgs));
 
-            std::string params;
-            paramPacker<void, Args...>(params);
-
-            sq_newclosure(vm, &detail::funcBinding<1, R, DefaultArgumentsImpl<DefaultArgs...>, Args...>::call, ndefparams ? 2 : 1);
-            sq_setparamscheck(vm, nparams - ndefparams + 1, nparams + 1, params.c_str());
-            if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
-                throw RuntimeException(vm, "Failed to bind function!");
-            }
+            NativeBinding binding;
+            binding.func = &detail::funcBinding<1, R, DefaultArgumentsImpl<DefaultArgs...>, Args...>::call;
+            binding.nfreevars = ndefparams ? 2 : 1;
+            binding.minParams = nparams - ndefparams + 1;
+            binding.maxParams = nparams + 1;
+            paramPacker<void, Args...>(binding.typemask);
+            paramTagPacker<void, Args...>(binding.paramTags);
+            return binding;
         }
         template<typename R, typename... Args, typename... DefaultArgs>
-        static void addFunc(HSQUIRRELVM vm, const char* name, const std::function<R(HSQUIRRELVM, Args...)>& func,
-                            DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
+        static NativeBinding bindFunc(HSQUIRRELVM vm, const char* name, const std::function<R(HSQUIRRELVM, Args...)>& func,
+                                      DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
             constexpr std::size_t nparams = sizeof...(Args);
             constexpr std::size_t ndefparams = sizeof...(DefaultArgs);
 
-            sq_pushstring(vm, name, strlen(name));
-
-            bindUserData(vm, func);
+            bindUserData(vm, func, name);
             bindUserData(vm, std::move(defaultArgs));
 
-            std::string params;
-            paramPacker<void, Args...>(params);
-
-            sq_newclosure(vm, &detail::funcBinding<0, R, DefaultArgumentsImpl<DefaultArgs...>, HSQUIRRELVM, Args...>::call, ndefparams ? 2 : 1);
-            sq_setparamscheck(vm, nparams - ndefparams + 1, nparams + 1, params.c_str());
-            if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
-                throw RuntimeException(vm, "Failed to bind function!");
-            }
+            NativeBinding binding;
+            binding.func = &detail::funcBinding<0, R, DefaultArgumentsImpl<DefaultArgs...>, HSQUIRRELVM, Args...>::call;
+            binding.nfreevars = ndefparams ? 2 : 1;
+            binding.minParams = nparams - ndefparams + 1;
+            binding.maxParams = nparams + 1;
+            paramPacker<void, Args...>(binding.typemask);
+            paramTagPacker<void, Args...>(binding.paramTags);
+            return binding;
         }
 
         template<typename R, typename... Args, typename... DefaultArgs>
-        static void addMemberFunc(HSQUIRRELVM vm, const char* name, const std::function<R(Args...)>& func,
-                                  DefaultArgumentsImpl<DefaultArgs...> defaultArgs, bool isStatic) {
+        static NativeBinding bindMemberFunc(HSQUIRRELVM vm, const char* name, const std::function<R(Args...)>& func,
+                                            DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
             constexpr std::size_t nparams = sizeof...(Args);
             constexpr std::size_t ndefparams = sizeof...(DefaultArgs);
 
-            sq_pushstring(vm, name, strlen(name));
+            bindUserData(vm, func, name);
+            bindUserData(vm, std::move(defaultArgs));
+
+            NativeBinding binding;
+            binding.func = &detail::funcBinding<0, R, DefaultArgumentsImpl<DefaultArgs...>, Args...>::call;
+            binding.nfreevars = ndefparams ? 2 : 1;
+            binding.minParams = nparams - ndefparams;
+            binding.maxParams = nparams;
+            paramPacker<Args...>(binding.typemask);
+            paramTagPacker<Args...>(binding.paramTags);
+            return binding;
+        }
+        template<typename R, typename... Args, typename... DefaultArgs>
+        static NativeBinding bindMemberFunc(HSQUIRRELVM vm, const char* name, const std::function<R(HSQUIRRELVM, Args...)>& func,
+                                            DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
+            constexpr std::size_t nparams = sizeof...(Args);
+            constexpr std::size_t ndefparams = sizeof...(DefaultArgs);
 
-            bindUserData(vm, func);
+            bindUserData(vm, func, name);
             bindUserData(vm, std::move(defaultArgs));
 
-            std::string params;
-            paramPacker<Args...>(params);
+            NativeBinding binding;
+            binding.func = &detail::funcBinding<-1, R, DefaultArgumentsImpl<DefaultArgs...>, HSQUIRRELVM, Args...>::call;
+            binding.nfreevars = ndefparams ? 2 : 1;
+            binding.minParams = nparams - ndefparams;
+            binding.maxParams = nparams;
+            paramPacker<Args...>(binding.typemask);
+            paramTagPacker<Args...>(binding.paramTags);
+            return binding;
+        }
+
+        template<typename Func, typename... DefaultArgs>
+        static NativeBinding bindStaticFunc(HSQUIRRELVM vm, DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
+            constexpr std::size_t nparams = Func::nparams;
+            constexpr std::size_t ndefparams = sizeof...(DefaultArgs);
+            constexpr int offset = Func::withVM ? 0 : 1;
+
+            bindUserData(vm, std::move(defaultArgs));
 
-            sq_newclosure(vm, &detail::funcBinding<0, R, DefaultArgumentsImpl<DefaultArgs...>, Args...>::call, ndefparams ? 2 : 1);
-            sq_setparamscheck(vm, nparams - ndefparams, nparams, params.c_str());
+            NativeBinding binding;
+            binding.func = &detail::staticFuncBinding<offset, Func, DefaultArgumentsImpl<DefaultArgs...>>::call;
+            binding.nfreevars = ndefparams ? 1 : 0;
+            binding.minParams = nparams - ndefparams + 1;
+            binding.maxParams = nparams + 1;
+            paramPacker<void>(binding.typemask);
+            Func::paramTypes(binding.typemask);
+            return binding;
+        }
+
+        template<typename Func, typename... DefaultArgs>
+        static NativeBinding bindStaticMemberFunc(HSQUIRRELVM vm, DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
+            constexpr std::size_t nparams = Func::nparams;
+            constexpr std::size_t ndefparams = sizeof...(DefaultArgs);
+            constexpr int offset = Func::withVM ? -1 : 0;
+
+            bindUserData(vm, std::move(defaultArgs));
+
+            NativeBinding binding;
+            binding.func = &detail::staticFuncBinding<offset, Func, DefaultArgumentsImpl<DefaultArgs...>>::call;
+            binding.nfreevars = ndefparams ? 1 : 0;
+            binding.minParams = nparams - ndefparams;
+            binding.maxParams = nparams;
+            Func::paramTypes(binding.typemask);
+            return binding;
+        }
+
+        template<typename F, typename... DefaultArgs>
+        static void addFunc(HSQUIRRELVM vm, const char* name, const F& func, DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
+            sq_pushstring(vm, name, strlen(name));
+            newNativeClosure(vm, bindFunc(vm, name, func, std::move(defaultArgs)));
             if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
                 throw RuntimeException(vm, "Failed to bind function!");
             }
         }
-        template<typename R, typename... Args, typename... DefaultArgs>
-        static void addMemberFunc(HSQUIRRELVM vm, const char* name, const std::function<R(HSQUIRRELVM, Args...)>& func,
-                                  DefaultArgumentsImpl<DefaultArgs...> defaultArgs, bool isStatic) {
-            constexpr std::size_t nparams = sizeof...(Args);
-            constexpr std::size_t ndefparams = sizeof...(DefaultArgs);
 
+        template<typename F, typename... DefaultArgs>
+        static void addMemberFunc(HSQUIRRELVM vm, const char* name, const F& func,
+                                  DefaultArgumentsImpl<DefaultArgs...> defaultArgs, bool isStatic) {
             sq_pushstring(vm, name, strlen(name));
+            newNativeClosure(vm, bindMemberFunc(vm, name, func, std::move(defaultArgs)));
+            if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                throw RuntimeException(vm, "Failed to bind function!");
+            }
+        }
 
-            bindUserData(vm, func);
-            bindUserData(vm, std::move(defaultArgs));
-
-            std::string params;
-            paramPacker<Args...>(params);
+        template<typename Func, typename... DefaultArgs>
+        static void addStaticFunc(HSQUIRRELVM vm, const char* name, DefaultArgumentsImpl<DefaultArgs...> defaultArgs) {
+            sq_pushstring(vm, name, strlen(name));
+            newNativeClosure(vm, bindStaticFunc<Func>(vm, std::move(defaultArgs)));
+            if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                throw RuntimeException(vm, "Failed to bind function!");
+            }
+        }
 
-            sq_newclosure(vm, &detail::funcBinding<-1, R, DefaultArgumentsImpl<DefaultArgs...>, HSQUIRRELVM, Args...>::call, ndefparams ? 2 : 1);
-            sq_setparamscheck(vm, nparams - ndefparams, nparams, params.c_str());
+        template<typename Func, typename... DefaultArgs>
+        static void addStaticMemberFunc(HSQUIRRELVM vm, const char* name, DefaultArgumentsImpl<DefaultArgs...> defaultArgs, bool isStatic) {
+            sq_pushstring(vm, name, strlen(name));
+            newNativeClosure(vm, bindStaticMemberFunc<Func>(vm, std::move(defaultArgs)));
             if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
                 throw RuntimeException(vm, "Failed to bind function!");
             }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "function.hpp"
+#include "interrupt.hpp"
+
+namespace ssq {
+    /**
+    * @brief Function bound to an environment, for calling it repeatedly from C++
+    * @details The function, its environment and its number of parameters are
+    * captured once. A call then only pushes the function, the environment and
+    * the arguments and calls it, without querying the closure again.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API BoundCall {
+    public:
+        /**
+        * @brief Creates an empty bound call
+        * @note This object won't be usable
+        */
+        BoundCall();
+        /**
+        * @brief Binds a function to an environment ("this" of the function)
+        * @throws RuntimeException if the function info cannot be obtained
+        */
+        BoundCall(const Function& func, const Object& env);
+        /**
+        * @brief Returns true if no function is bound
+        */
+        bool isEmpty() const;
+        /**
+        * @brief Returns the bound function
+        */
+        Function getFunction() const;
+        /**
+        * @brief Returns the bound environment
+        */
+        const Object& getEnv() const;
+        /**
+        * @brief Returns the minimum and maximum number of parameters accepted by the function as a pair
+        * @note This ignores the "this" pointer
+        */
+        std::pair<unsigned int, unsigned int> getNumOfParams() const;
+        /**
+        * @brief Calls the function and returns its return value as an Object
+        * @throws RuntimeException if an exception is thrown or number of arguments
+        * do not match
+        */
+        template<class... Args>
+        Object operator()(Args&&... args) const {
+            return call<Object>(std::forward<Args>(args)...);
+        }
+        /**
+        * @brief Calls the function and returns its return value as type R
+        * @details The return value is read directly from the stack, R can be void
+        * @throws RuntimeException if an exception is thrown or number of arguments
+        * do not match
+        * @throws TypeException if the return value cannot be converted to R
+        */
+        template<class R, class... Args>
+        R call(Args&&... args) const {
+            static const std::size_t params = sizeof...(Args);
+            checkNumOfParams(params);
+
+            detail::ExecutionScope execution(vm);
+            detail::checkInterrupt(vm, detail::SafePoint::CALL_FROM_CPP);
+            AllocatorScope scope(vm);
+            const SQInteger top = sq_gettop(vm);
+            sq_pushobject(vm, func.getRaw());
+            sq_pushobject(vm, env.getRaw());
+
+            detail::pushArgs(vm, std::forward<Args>(args)...);
+
+            return detail::callPushedAndPop<R>(vm, params, top);
+        }
+
+    private:
+        void checkNumOfParams(std::size_t params) const;
+
+        HSQUIRRELVM vm;
+        Object func;
+        Object env;
+        unsigned int minParams;
+        unsigned int maxParams;
+    };
+}
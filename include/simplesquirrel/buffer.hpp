@@ -0,0 +1,162 @@
+#pragma once
+
+#include "args.hpp"
+
+#include <squirrel.h>
+#include <stdint.h>
+#include <type_traits>
+
+namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        enum class BufferType: uint8_t {
+            INT8,
+            UINT8,
+            INT16,
+            UINT16,
+            INT32,
+            UINT32,
+            INT64,
+            UINT64,
+            FLOAT,
+            DOUBLE
+        };
+
+        template<typename T>
+        constexpr BufferType bufferTypeOf() {
+            return std::is_floating_point<T>::value ? (sizeof(T) == sizeof(float) ? BufferType::FLOAT : BufferType::DOUBLE) :
+                sizeof(T) == 1 ? (std::is_signed<T>::value ? BufferType::INT8 : BufferType::UINT8) :
+                sizeof(T) == 2 ? (std::is_signed<T>::value ? BufferType::INT16 : BufferType::UINT16) :
+                sizeof(T) == 4 ? (std::is_signed<T>::value ? BufferType::INT32 : BufferType::UINT32) :
+                (std::is_signed<T>::value ? BufferType::INT64 : BufferType::UINT64);
+        }
+
+        /**
+        * @brief The contents of a buffer user data
+        */
+        struct BufferView {
+            void* data;
+            size_t size;
+            BufferType type;
+            bool readOnly;
+        };
+
+        /**
+        * @brief Creates the delegate of buffers, if the VM does not have it yet
+        */
+        SSQ_API void registerBufferLib(HSQUIRRELVM vm);
+        SSQ_API void pushBuffer(HSQUIRRELVM vm, const BufferView& view);
+        /**
+        * @brief Returns the view of a buffer on the stack
+        * @throws TypeException if the value is not a buffer of the type, or the buffer is read-only and writable is true
+        */
+        SSQ_API BufferView getBuffer(HSQUIRRELVM vm, SQInteger index, BufferType type, bool writable);
+    }
+#endif
+
+    /**
+    * @brief A contiguous region of C++ memory passed to scripts without a copy
+    * @details A buffer is pushed to Squirrel as a small user data that points at
+    * the memory, so no element is converted until a script reads or writes it.
+    * Scripts index it like an array, `buf[i]` and `buf[i] = x`, get its length with
+    * `buf.len()` and can iterate over it with foreach. Indices out of bounds raise
+    * an error. A buffer of const elements is read-only for scripts.
+    *
+    * The buffer does not own the memory, which must stay valid and must not move
+    * as long as scripts can reach the buffer. T must be an integer of 1, 2, 4 or
+    * 8 bytes, float or double. Integers are converted to and from Squirrel integers,
+    * so 64-bit unsigned values wrap on 32-bit builds.
+    * @ingroup simplesquirrel
+    */
+    template<typename T>
+    class Buffer {
+    public:
+        typedef typename std::remove_const<T>::type ValueType;
+
+        static_assert(std::is_arithmetic<ValueType>::value && !std::is_same<ValueType, bool>::value,
+            "Buffers can only hold integers or floating point numbers");
+        static_assert(std::is_integral<ValueType>::value ?
+            sizeof(ValueType) == 1 || sizeof(ValueType) == 2 || sizeof(ValueType) == 4 || sizeof(ValueType) == 8 :
+            std::is_same<ValueType, float>::value || std::is_same<ValueType, double>::value,
+            "Buffers can only hold integers of 1, 2, 4 or 8 bytes, float or double");
+
+        /**
+        * @brief Creates an empty buffer
+        */
+        Buffer():ptr(nullptr), len(0) {
+        }
+        /**
+        * @brief Creates a buffer of count elements at data
+        */
+        Buffer(T* data, size_t count):ptr(data), len(count) {
+        }
+        /**
+        * @brief Creates a buffer of the elements of a contiguous container, such as std::vector
+        */
+        template<typename Container>
+        explicit Buffer(Container& container):ptr(container.data()), len(container.size()) {
+        }
+        /**
+        * @brief Returns the first element
+        */
+        T* data() const {
+            return ptr;
+        }
+        /**
+        * @brief Returns the number of elements
+        */
+        size_t size() const {
+            return len;
+        }
+        /**
+        * @brief Returns true if the buffer has no elements
+        */
+        bool empty() const {
+            return len == 0;
+        }
+        /**
+        * @brief Returns the element at the index, which is not checked
+        */
+        T& operator[] (size_t index) const {
+            return ptr[index];
+        }
+        /**
+        * @brief Returns the first element
+        */
+        T* begin() const {
+            return ptr;
+        }
+        /**
+        * @brief Returns the end of the buffer
+        */
+        T* end() const {
+            return ptr + len;
+        }
+    private:
+        T* ptr;
+        size_t len;
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        template<typename T>
+        struct BufferTraits<Buffer<T>>: std::true_type {
+            typedef typename Buffer<T>::ValueType ValueType;
+
+            static Buffer<T> pop(HSQUIRRELVM vm, SQInteger index) {
+                const BufferView view = getBuffer(vm, index, bufferTypeOf<ValueType>(), !std::is_const<T>::value);
+                return Buffer<T>(static_cast<T*>(view.data), view.size);
+            }
+
+            static void push(HSQUIRRELVM vm, const Buffer<T>& value) {
+                BufferView view;
+                view.data = const_cast<ValueType*>(value.data());
+                view.size = value.size();
+                view.type = bufferTypeOf<ValueType>();
+                view.readOnly = std::is_const<T>::value;
+                pushBuffer(vm, view);
+            }
+        };
+    }
+#endif
+}
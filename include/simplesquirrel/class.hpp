@@ -2,9 +2,46 @@
 
 #include <functional>
 #include "function.hpp"
+#include "key.hpp"
 #include "binding.hpp"
+#include "overload.hpp"
 
 namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /* Reads (pushes) or writes (from stack index 3) a member variable of the instance */
+        typedef SQInteger(*VarAccessorFunc)(HSQUIRRELVM vm, SQUserPointer self, SQUserPointer accessor);
+
+        template<typename M>
+        struct VarAccessor {
+            VarAccessorFunc func; // Must be the first member
+            M member;
+        };
+
+        /* Returns the "_get" or "_set" key of the VM, created with it */
+        SSQ_API const Key& getVarTableKey(HSQUIRRELVM vm, bool set);
+
+        inline SQUserPointer varAccessorTypeTag() {
+            static const auto hashCode = typeid(VarAccessorFunc).hash_code();
+            return reinterpret_cast<SQUserPointer>(hashCode);
+        }
+
+        template<typename T, typename V>
+        static SQInteger varGetAccessor(HSQUIRRELVM vm, SQUserPointer self, SQUserPointer accessor) {
+            auto var = reinterpret_cast<VarAccessor<V T::*>*>(accessor);
+            detail::push(vm, static_cast<T*>(self)->*(var->member));
+            return 1;
+        }
+
+        template<typename T, typename V>
+        static SQInteger varSetAccessor(HSQUIRRELVM vm, SQUserPointer self, SQUserPointer accessor) {
+            auto var = reinterpret_cast<VarAccessor<V T::*>*>(accessor);
+            static_cast<T*>(self)->*(var->member) = detail::pop<V>(vm, 3);
+            return 0;
+        }
+    }
+#endif
+
     /**
     * @brief Squirrel class object
     * @ingroup simplesquirrel
@@ -72,6 +109,7 @@ namespace ssq {
         template <typename Return, typename Object, typename... Args, typename... DefaultArgs>
         Function addFunc(const char* name, const std::function<Return(Object*, Args...)>& func, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}, bool isStatic = false) {
             if (vm == nullptr) throw RuntimeException(nullptr, "VM is not initialised");
+            detail::ObjectAllocatorScope scope(vm);
             Function ret(vm);
             sq_pushobject(vm, obj);
             detail::addMemberFunc(vm, name, func, std::move(defaultArgs), isStatic);
@@ -120,35 +158,90 @@ namespace ssq {
         Function addFunc(const char* name, const F& lambda, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}, bool isStatic = false) {
             return addFunc(name, detail::make_function(lambda), std::move(defaultArgs), isStatic);
         }
+        /**
+        * @brief Adds a new function type to this class, bound to a member function
+        * pointer known at compile time
+        * @details The native trampoline calls the member function directly, without
+        * std::function or a function userdata. Usage: addFunc<decltype(&T::f), &T::f>("f")
+        * @param name Name of the function to add
+        * @param defaultArgs A list of default values for last optional arguments
+        * @param isStatic Determines whether the function is going to be static
+        * @throws RuntimeException if VM is invalid
+        * @returns Function object references the added function
+        */
+        template<typename F, F func, typename... DefaultArgs>
+        Function addFunc(const char* name, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}, bool isStatic = false) {
+            if (vm == nullptr) throw RuntimeException(nullptr, "VM is not initialised");
+            detail::ObjectAllocatorScope scope(vm);
+            Function ret(vm);
+            sq_pushobject(vm, obj);
+            detail::addStaticMemberFunc<detail::StaticFunc<F, func>>(vm, name, std::move(defaultArgs), isStatic);
+            sq_pop(vm, 1);
+            return ret;
+        }
+#ifdef SSQ_CXX17
+        /**
+        * @brief Adds a new function type to this class, bound to a member function
+        * pointer known at compile time. Usage: addFunc<&T::f>("f")
+        * @throws RuntimeException if VM is invalid
+        * @returns Function object references the added function
+        */
+        template<auto func, typename... DefaultArgs>
+        Function addFunc(const char* name, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}, bool isStatic = false) {
+            return addFunc<decltype(func), func>(name, std::move(defaultArgs), isStatic);
+        }
+#endif
+        /**
+        * @brief Adds several functions under one name, the one called is picked by the arguments
+        * @details Each function is a member function pointer, or a std::function or lambda
+        * that takes "this" pointer first, as with addFunc. The number and the types of the
+        * arguments are looked up in a table built here, so the call does not try the
+        * functions one by one. If more functions accept the arguments, the first one wins.
+        * Squirrel raises an error if none does. Usage: addOverloads("set", &T::setInt, &T::setStr)
+        * @param name Name of the function to add
+        * @param funcs Up to 64 functions
+        * @throws RuntimeException if VM is invalid
+        * @returns Function object references the added function
+        */
+        template<typename... Funcs>
+        Function addOverloads(const char* name, const Funcs&... funcs) {
+            if (vm == nullptr) throw RuntimeException(nullptr, "VM is not initialised");
+            detail::ObjectAllocatorScope scope(vm);
+            Function ret(vm);
+            sq_pushobject(vm, obj);
+            detail::addMemberOverloads(vm, name, funcs...);
+            sq_pop(vm, 1);
+            return ret;
+        }
         template<typename T, typename V>
         void addVar(const std::string& name, V T::* ptr, bool isStatic = false) {
-            findTable("_get", tableGet, dlgGetStub);
-            findTable("_set", tableSet, dlgSetStub);
+            findTable(detail::getVarTableKey(vm, false), tableGet, dlgGetStub);
+            findTable(detail::getVarTableKey(vm, true), tableSet, dlgSetStub);
 
-            bindVar<T, V>(name, ptr, tableGet.getRaw(), varGetStub<T, V>, isStatic);
-            bindVar<T, V>(name, ptr, tableSet.getRaw(), varSetStub<T, V>, isStatic);
+            bindVar<T, V>(name, ptr, tableGet.getRaw(), &detail::varGetAccessor<T, V>, isStatic);
+            bindVar<T, V>(name, ptr, tableSet.getRaw(), &detail::varSetAccessor<T, V>, isStatic);
         }
         template<typename T, typename V>
         void addVar(const std::string& name, V T::* ptr, void(T::*memsetter)(V), bool isStatic = false) {
-            findTable("_get", tableGet, dlgGetStub);
-            findTable("_set", tableSet, dlgSetStub);
+            findTable(detail::getVarTableKey(vm, false), tableGet, dlgGetStub);
+            findTable(detail::getVarTableKey(vm, true), tableSet, dlgSetStub);
 
-            bindVar<T, V>(name, ptr, tableGet.getRaw(), varGetStub<T, V>, isStatic);
+            bindVar<T, V>(name, ptr, tableGet.getRaw(), &detail::varGetAccessor<T, V>, isStatic);
             bindSetter(name, std::function<void(T*, V)>(std::mem_fn(memsetter)), tableSet.getRaw(), isStatic);
         }
         template<typename T, typename V>
         void addVar(const std::string& name, V(T::*memgetter)() const, void(T::*memsetter)(V), bool isStatic = false) {
-            findTable("_get", tableGet, dlgGetStub);
-            findTable("_set", tableSet, dlgSetStub);
+            findTable(detail::getVarTableKey(vm, false), tableGet, dlgGetStub);
+            findTable(detail::getVarTableKey(vm, true), tableSet, dlgSetStub);
 
             bindGetter(name, std::function<V(T*)>(std::mem_fn(memgetter)), tableGet.getRaw(), isStatic);
             bindSetter(name, std::function<void(T*, V)>(std::mem_fn(memsetter)), tableSet.getRaw(), isStatic);
         }
         template<typename T, typename V>
         void addConstVar(const std::string& name, V T::* ptr, bool isStatic = false) {
-            findTable("_get", tableGet, dlgGetStub);
+            findTable(detail::getVarTableKey(vm, false), tableGet, dlgGetStub);
 
-            bindVar<T, V>(name, ptr, tableGet.getRaw(), varGetStub<T, V>, isStatic);
+            bindVar<T, V>(name, ptr, tableGet.getRaw(), &detail::varGetAccessor<T, V>, isStatic);
         }
         /**
         * @brief Copy assingment operator
@@ -159,18 +252,19 @@ namespace ssq {
         */
         Class& operator = (Class&& other) NOEXCEPT;
     protected:
-        void findTable(const char* name, Object& table, SQFUNCTION dlg) const;
+        void findTable(const Key& key, Object& table, SQFUNCTION dlg) const;
         static SQInteger dlgGetStub(HSQUIRRELVM vm);
         static SQInteger dlgSetStub(HSQUIRRELVM vm);
 
         template<typename T, typename V>
         void bindGetter(const std::string& name, const std::function<V(T*)>& getter, HSQOBJECT& table, bool isStatic) {
+            detail::ObjectAllocatorScope scope(vm);
             auto rst = sq_gettop(vm);
 
             sq_pushobject(vm, table);
             sq_pushstring(vm, name.c_str(), name.size());
 
-            detail::bindUserData(vm, getter);
+            detail::bindUserData(vm, getter, name.c_str());
 
             sq_newclosure(vm, &detail::funcBinding<0, V, DefaultArgumentsImpl<>, T*>::call, 1);
 
@@ -183,12 +277,13 @@ namespace ssq {
         }
         template<typename T, typename V>
         void bindSetter(const std::string& name, const std::function<void(T*, V)>& setter, HSQOBJECT& table, bool isStatic) {
+            detail::ObjectAllocatorScope scope(vm);
             auto rst = sq_gettop(vm);
 
             sq_pushobject(vm, table);
             sq_pushstring(vm, name.c_str(), name.size());
 
-            detail::bindUserData(vm, setter);
+            detail::bindUserData(vm, setter, name.c_str());
 
             sq_newclosure(vm, &detail::funcBinding<0, void, DefaultArgumentsImpl<>, T*, V>::call, 1);
 
@@ -200,17 +295,19 @@ namespace ssq {
             sq_settop(vm, rst);
         }
 
+        /* Member variables are stored as accessor userdata, called directly by the delegate stubs */
         template<typename T, typename V>
-        void bindVar(const std::string& name, V T::* ptr, HSQOBJECT& table, SQFUNCTION stub, bool isStatic) {
+        void bindVar(const std::string& name, V T::* ptr, HSQOBJECT& table, detail::VarAccessorFunc func, bool isStatic) {
+            detail::ObjectAllocatorScope scope(vm);
             auto rst = sq_gettop(vm);
 
             sq_pushobject(vm, table);
             sq_pushstring(vm, name.c_str(), name.size());
 
-            auto vp = sq_newuserdata(vm, sizeof(ptr));
-            std::memcpy(vp, &ptr, sizeof(ptr));
-
-            sq_newclosure(vm, stub, 1);
+            auto accessor = reinterpret_cast<detail::VarAccessor<V T::*>*>(sq_newuserdata(vm, sizeof(detail::VarAccessor<V T::*>)));
+            accessor->func = func;
+            accessor->member = ptr;
+            sq_settypetag(vm, -1, detail::varAccessorTypeTag());
 
             if (SQ_FAILED(sq_newslot(vm, -3, isStatic))) {
                 throw RuntimeException(vm, "Failed to bind member variable to class!");
@@ -220,34 +317,6 @@ namespace ssq {
             sq_settop(vm, rst);
         }
 
-        template<typename T, typename V>
-        static SQInteger varGetStub(HSQUIRRELVM vm_) {
-            T* ptr;
-            sq_getinstanceup(vm_, 1, reinterpret_cast<SQUserPointer*>(&ptr), nullptr, SQTrue);
-
-            typedef V T::*M;
-            M* memberPtr = nullptr;
-            sq_getuserdata(vm_, -1, reinterpret_cast<SQUserPointer*>(&memberPtr), nullptr);
-            M member = *memberPtr;
-
-            detail::push(vm_, ptr->*member);
-            return 1;
-        }
-
-        template<typename T, typename V>
-        static SQInteger varSetStub(HSQUIRRELVM vm_) {
-            T* ptr;
-            sq_getinstanceup(vm_, 1, reinterpret_cast<SQUserPointer*>(&ptr), nullptr, SQTrue);
-
-            typedef V T::*M;
-            M* memberPtr = nullptr;
-            sq_getuserdata(vm_, -1, reinterpret_cast<SQUserPointer*>(&memberPtr), nullptr);
-            M member = *memberPtr;
-
-            ptr->*member = detail::pop<V>(vm_, 2);
-            return 0;
-        }
-
         Object tableSet;
         Object tableGet;
     };
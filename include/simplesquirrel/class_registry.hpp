@@ -0,0 +1,85 @@
+#pragma once
+
+#include "object.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /**
+        * @brief Maps type tags of exposed C++ classes to their Squirrel class objects
+        * @details Flat open addressing table with linear probing. The capacity is
+        * always a power of two, an empty slot is marked by a null object.
+        * The class objects are not referenced, they are owned by the table or
+        * class they have been added into.
+        */
+        class SSQ_API ClassRegistry {
+        public:
+            ClassRegistry();
+            /**
+            * @brief Adds or replaces the class object for the type tag
+            */
+            void insert(size_t hashCode, const HSQOBJECT& obj);
+            /**
+            * @brief Returns the class object for the type tag or nullptr if not found
+            */
+            const HSQOBJECT* find(size_t hashCode) const;
+            /**
+            * @brief Removes all class objects
+            */
+            void clear();
+            /**
+            * @brief Returns the number of registered classes
+            */
+            size_t size() const;
+            /**
+            * @brief Returns a value that changes whenever this registry is modified
+            * @details Generations are unique across all registries, so a lookup result
+            * cached together with its generation can never be confused between VMs.
+            */
+            uint64_t getGeneration() const {
+                return generation;
+            }
+            /**
+            * @brief Swaps two registries
+            */
+            void swap(ClassRegistry& other) NOEXCEPT;
+
+        private:
+            struct Slot {
+                size_t hashCode;
+                HSQOBJECT obj;
+            };
+
+            size_t slotIndex(size_t hashCode) const;
+            void rehash(size_t capacity);
+
+            std::vector<Slot> slots;
+            size_t count;
+            uint64_t generation;
+        };
+
+        /**
+        * @brief Copies instances of an exposed class out of one VM and into another
+        * @details Used by Message. Copiers are keyed by the same type tag as the
+        * class objects, and shared by all VMs, as type tags are the same everywhere.
+        */
+        struct ClassCopier {
+            void* (*copy)(const void* ptr);
+            void (*destroy)(void* ptr);
+            void (*push)(HSQUIRRELVM vm, const void* ptr);
+        };
+
+        /**
+        * @brief Adds or replaces the copier for the type tag, thread safe
+        */
+        SSQ_API void addClassCopier(size_t hashCode, const ClassCopier& copier);
+        /**
+        * @brief Returns the copier for the type tag or nullptr if the class cannot be copied, thread safe
+        */
+        SSQ_API const ClassCopier* findClassCopier(size_t hashCode);
+    }
+#endif
+}
@@ -40,6 +40,7 @@ namespace ssq {
          */
         template<typename T>
         void addSlot(const char* name, const T& value) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_pushobject(vm, obj);
             sq_pushstring(vm, name, strlen(name));
             detail::push<T>(vm, value);
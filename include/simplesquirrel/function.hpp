@@ -48,6 +48,40 @@ namespace ssq {
     };
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     namespace detail {
+        inline void pushArgs(HSQUIRRELVM) {
+
+        }
+
+        template <class First, class... Rest>
+        inline void pushArgs(HSQUIRRELVM vm, First&& first, Rest&&... rest) {
+            detail::push(vm, first);
+            pushArgs(vm, std::forward<Rest>(rest)...);
+        }
+
+        /* Calls the function pushed below the environment and arguments, restores the top on failure */
+        SSQ_API void callPushed(HSQUIRRELVM vm, SQUnsignedInteger nparams, bool retval, SQInteger top);
+
+        /* Calls the pushed function and reads its return value straight from the stack */
+        template<typename R>
+        inline R callPushedAndPop(HSQUIRRELVM vm, SQUnsignedInteger nparams, SQInteger top) {
+            static_assert(!is_string_view<R>::value, "A string view cannot outlive the call it's passed to, use std::string");
+            callPushed(vm, nparams, true, top);
+            try {
+                R ret(detail::pop<R>(vm, -1));
+                sq_settop(vm, top);
+                return ret;
+            } catch (...) {
+                sq_settop(vm, top);
+                std::rethrow_exception(std::current_exception());
+            }
+        }
+
+        template<>
+        inline void callPushedAndPop<void>(HSQUIRRELVM vm, SQUnsignedInteger nparams, SQInteger top) {
+            callPushed(vm, nparams, false, top);
+            sq_settop(vm, top);
+        }
+
         template<>
         inline Function popValue(HSQUIRRELVM vm, SQInteger index){
             checkType(vm, index, OT_CLOSURE);
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "exceptions.hpp"
+#include "type.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ssq {
+    /**
+    * @brief Limits how long a script runs when called from C++
+    * @details The budget applies to each VM::run(), VM::runAndReturn(),
+    * VM::callFunc() and BoundCall call made from C++, including everything
+    * the script calls from there. Execution is counted with the debug hook of
+    * Squirrel, by the number of executed lines, calls and returns, which is the
+    * closest thing to instructions Squirrel reports, and with SSQ_SQUIRREL_INTERRUPT,
+    * loop iterations. Lines are only reported for scripts compiled with debug info,
+    * which setting a budget enables.
+    * @ingroup simplesquirrel
+    */
+    struct ExecutionBudget {
+        /** @brief Number of executed lines, calls, returns and loop iterations, 0 for no limit */
+        uint64_t instructions;
+        /** @brief Wall clock time in microseconds, 0 for no limit */
+        uint64_t microseconds;
+        /**
+        * @brief Skips the try blocks of scripts once the budget runs out, false by default
+        * @details Only with SSQ_SQUIRREL_INTERRUPT. By default a script can catch the error,
+        * as any other, but it's raised again at every following safe point of the call,
+        * so a script that keeps catching it in a loop is never stopped. Set this to unwind
+        * the call through the try blocks of scripts instead, which changes the semantics
+        * of try/catch for the scripts run under the budget.
+        */
+        bool uncatchable;
+    };
+
+    /**
+    * @brief Why the last call into a VM was stopped
+    * @ingroup simplesquirrel
+    */
+    enum class StopReason {
+        NONE = 0,
+        INSTRUCTIONS,
+        TIME,
+        MEMORY
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Number of main VMs with a budget, memory limit or collection interval, defined in vm.cpp.
+        // Only those can have an interrupt pending, so safe points cost one load while there are none
+        extern SSQ_API std::atomic<size_t> numOfInterruptibleVMs;
+        // Where the VM is checked. Requested collections only run where no native function
+        // of simplesquirrel is in the middle of its work: at calls from C++ that aren't nested
+        // in another call, and inside scripts
+        enum class SafePoint {
+            NATIVE_CALL,
+            CALL_FROM_CPP,
+            SCRIPT
+        };
+        // Returns the reason the VM has to stop and records it, nullptr if it doesn't, defined in vm.cpp.
+        // Only the flags of the main VM are read when nothing is pending, so other VMs are never slowed down
+        SSQ_API const char* getInterrupt(HSQUIRRELVM vm, SafePoint point);
+        // Called by Squirrel when built with SSQ_SQUIRREL_INTERRUPT, while the debug hook is set: after each
+        // line event ('l'), at each backward jump ('j') and before a script catches an error ('t').
+        // Nonzero raises the error set with sq_throwerror, or skips the catch, defined in vm.cpp
+        SSQ_API SQInteger interruptExecution(HSQUIRRELVM vm, SQInteger point);
+
+        struct SamplingProfiler;
+
+        // Execution of the main VM and its threads, from the outermost call from C++
+        struct ExecutionState {
+            ExecutionBudget budget;
+            HSQUIRRELVM outermost;
+            unsigned depth;
+            uint64_t count;
+            std::chrono::steady_clock::time_point deadline;
+            StopReason stopReason;
+            // A budget ran out, the script is stopped at the next safe point
+            bool armed;
+            // Not null while profiling
+            SamplingProfiler* profiler;
+            // A memory limit or collection interval is set, which needs the debug hook to act inside scripts
+            bool watchMemory;
+            // The script caught going over the memory limit, at this number of allocations
+            bool memoryCaught;
+            size_t caughtAllocations;
+            // Set with VM::setNativeDebugHook, called before the hook of simplesquirrel and set again once it's removed
+            SQDEBUGHOOK userHook;
+            // Counted in numOfInterruptibleVMs
+            bool interruptible;
+
+            ExecutionState():budget(), outermost(nullptr), depth(0), count(0), deadline(), stopReason(StopReason::NONE), armed(false),
+                profiler(nullptr), watchMemory(false), memoryCaught(false), caughtAllocations(0), userHook(nullptr),
+                interruptible(false) {
+            }
+        };
+
+        SSQ_API ExecutionState* getExecutionState(HSQUIRRELVM vm);
+
+        // Starts counting the budget when entered from C++, keeping count in nested calls
+        class SSQ_API ExecutionScope {
+        public:
+            explicit ExecutionScope(HSQUIRRELVM vm);
+            ~ExecutionScope();
+            ExecutionScope(const ExecutionScope& other) = delete;
+            ExecutionScope& operator = (const ExecutionScope& other) = delete;
+        private:
+            HSQUIRRELVM vm;
+            ExecutionState* state;
+            bool hooked;
+        };
+
+        // Safe point, checked before native functions bound by simplesquirrel run
+        // and before the VM runs a script or calls a function
+        inline void checkInterrupt(HSQUIRRELVM vm, SafePoint point = SafePoint::NATIVE_CALL) {
+            if (numOfInterruptibleVMs.load(std::memory_order_relaxed) == 0) {
+                return;
+            }
+            const char* reason = getInterrupt(vm, point);
+            if (reason != nullptr) {
+                throw RuntimeException(vm, reason);
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "object.hpp"
+
+#include <string>
+
+namespace ssq {
+    /**
+    * @brief Pre-created Squirrel string used as a table or object key
+    * @details Lookups by Key push the string object directly, without calling
+    * strlen and creating (hashing and interning) the string on each call.
+    * A key can be used with any object of the VM it was created in, including
+    * its threads.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Key: public Object {
+    public:
+        /**
+        * @brief Creates an empty key with null VM
+        * @note This key will be unusable
+        */
+        Key();
+        /**
+        * @brief Creates a key from a string
+        */
+        Key(HSQUIRRELVM vm, const char* name);
+        /**
+        * @brief Destructor
+        */
+        virtual ~Key() override = default;
+        /**
+        * @brief Copy constructor
+        */
+        Key(const Key& other);
+        /**
+        * @brief Move constructor
+        */
+        Key(Key&& other) NOEXCEPT;
+        /**
+        * @brief Swaps two keys
+        */
+        void swap(Key& other) NOEXCEPT;
+        /**
+        * @brief Returns the string of this key
+        */
+        const std::string& getName() const;
+        /**
+        * @brief Copy assingment operator
+        */
+        Key& operator = (const Key& other);
+        /**
+        * @brief Move assingment operator
+        */
+        Key& operator = (Key&& other) NOEXCEPT;
+
+    private:
+        std::string name;
+    };
+}
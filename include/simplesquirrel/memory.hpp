@@ -0,0 +1,300 @@
+#pragma once
+
+#include "type.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace ssq {
+    /**
+    * @brief Memory allocator of a VM
+    * @details Every block returned by allocate() must be aligned for any
+    * fundamental type. The size passed to deallocate() and reallocate() is
+    * the size the block was last allocated with. An allocator is used by one
+    * VM (and its threads) at a time and does not need to be thread safe.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Allocator {
+    public:
+        virtual ~Allocator() = default;
+        /**
+        * @brief Allocates a block of memory, returns nullptr on failure
+        */
+        virtual void* allocate(size_t size) = 0;
+        /**
+        * @brief Releases a block of memory
+        */
+        virtual void deallocate(void* ptr, size_t size) = 0;
+        /**
+        * @brief Resizes a block of memory, returns nullptr on failure
+        * @details The default implementation allocates a new block, copies the
+        * contents and deallocates the old block.
+        */
+        virtual void* reallocate(void* ptr, size_t oldSize, size_t newSize);
+    };
+
+    /**
+    * @brief Allocator using malloc, realloc and free
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API MallocAllocator: public Allocator {
+    public:
+        virtual void* allocate(size_t size) override;
+        virtual void deallocate(void* ptr, size_t size) override;
+        virtual void* reallocate(void* ptr, size_t oldSize, size_t newSize) override;
+    };
+
+    /**
+    * @brief Bump allocator that releases all of its memory at once
+    * @details Blocks are carved out of large chunks. Deallocating a block
+    * does not reclaim its memory, unless it is the most recent allocation.
+    * All chunks are freed when the arena is destroyed or released, which makes
+    * tearing down a short-lived VM cheap, at the cost of memory that grows with
+    * every allocation the VM makes during its lifetime.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API ArenaAllocator: public Allocator {
+    public:
+        /**
+        * @brief Creates an arena, allocating chunks of the given size
+        */
+        explicit ArenaAllocator(size_t chunkSize = 64 * 1024);
+        /**
+        * @brief Frees all chunks
+        */
+        virtual ~ArenaAllocator() override;
+        virtual void* allocate(size_t size) override;
+        virtual void deallocate(void* ptr, size_t size) override;
+        virtual void* reallocate(void* ptr, size_t oldSize, size_t newSize) override;
+        /**
+        * @brief Frees all chunks, invalidating every block allocated so far
+        */
+        void release();
+        /**
+        * @brief Returns the number of bytes held in chunks
+        */
+        size_t getReserved() const;
+        /**
+        * @brief Disabled copy constructor
+        */
+        ArenaAllocator(const ArenaAllocator& other) = delete;
+        /**
+        * @brief Disabled copy assingment operator
+        */
+        ArenaAllocator& operator = (const ArenaAllocator& other) = delete;
+    private:
+        struct Chunk;
+        Chunk* head;
+        size_t chunkSize;
+        size_t reserved;
+        char* lastBlock;
+    };
+
+    /**
+    * @brief Allocator with free lists for small size classes
+    * @details Blocks up to maxBlockSize bytes are rounded up to a size class
+    * and reused through a free list of that class. Their memory is taken from
+    * an arena and freed when the pool is destroyed. Larger blocks use malloc.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API PoolAllocator: public Allocator {
+    public:
+        /**
+        * @brief The largest block served from the size classes
+        */
+        static const size_t maxBlockSize = 1024;
+        /**
+        * @brief Creates a pool, taking blocks from chunks of the given size
+        */
+        explicit PoolAllocator(size_t chunkSize = 64 * 1024);
+        virtual ~PoolAllocator() override = default;
+        virtual void* allocate(size_t size) override;
+        virtual void deallocate(void* ptr, size_t size) override;
+        virtual void* reallocate(void* ptr, size_t oldSize, size_t newSize) override;
+        /**
+        * @brief Disabled copy constructor
+        */
+        PoolAllocator(const PoolAllocator& other) = delete;
+        /**
+        * @brief Disabled copy assingment operator
+        */
+        PoolAllocator& operator = (const PoolAllocator& other) = delete;
+    private:
+        static const size_t numClasses = 20;
+        ArenaAllocator arena;
+        void* freeLists[numClasses];
+    };
+
+    /**
+    * @brief Memory usage of a VM, in bytes including the bookkeeping of each block
+    * @ingroup simplesquirrel
+    */
+    struct MemoryStats {
+        /** @brief Bytes currently allocated */
+        size_t current;
+        /** @brief The highest number of bytes allocated at once */
+        size_t peak;
+        /** @brief Number of blocks allocated so far */
+        size_t allocations;
+        /** @brief The memory limit, 0 if there is none */
+        size_t limit;
+    };
+
+    /**
+    * @brief Garbage collections of a VM
+    * @details Squirrel frees most objects by reference counting, the garbage
+    * collector only frees objects kept alive by reference cycles.
+    * @ingroup simplesquirrel
+    */
+    struct GarbageCollectionStats {
+        /** @brief Number of collections so far */
+        size_t collections;
+        /** @brief Objects freed by the last collection */
+        size_t lastFreed;
+        /** @brief Objects freed by all collections */
+        size_t totalFreed;
+        /** @brief Duration of the last collection in microseconds */
+        uint64_t lastMicroseconds;
+        /** @brief Duration of the longest collection in microseconds */
+        uint64_t maxMicroseconds;
+        /** @brief Duration of all collections in microseconds */
+        uint64_t totalMicroseconds;
+    };
+
+    /**
+    * @brief Makes an allocator the current one of the calling thread
+    * @details Squirrel allocates through global functions that have no access
+    * to the VM. When simplesquirrel is built with SSQ_CUSTOM_ALLOCATORS, these
+    * allocate from the current allocator of the thread, and release memory to
+    * whichever allocator it came from. The VM activates its own allocator while
+    * it is created, destroyed, compiles, runs scripts and calls functions, and
+    * the allocator of the VM an object belongs to while tables, arrays, classes
+    * and the like are created or modified through simplesquirrel. Only work
+    * done through the raw Squirrel API has to be wrapped in a scope to
+    * allocate from the allocator of the VM. Scopes can be nested, the previous
+    * allocator is restored when the scope ends. A nullptr allocator means the
+    * default heap.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API AllocatorScope {
+    public:
+        /**
+        * @brief Makes the allocator current
+        */
+        explicit AllocatorScope(Allocator* allocator);
+        /**
+        * @brief Makes the allocator of the VM current, the default heap if vm is nullptr
+        */
+        explicit AllocatorScope(HSQUIRRELVM vm);
+        /**
+        * @brief Makes the default heap current
+        */
+        explicit AllocatorScope(std::nullptr_t);
+        /**
+        * @brief Restores the previous allocator
+        */
+        ~AllocatorScope();
+        /**
+        * @brief Disabled copy constructor
+        */
+        AllocatorScope(const AllocatorScope& other) = delete;
+        /**
+        * @brief Disabled copy assingment operator
+        */
+        AllocatorScope& operator = (const AllocatorScope& other) = delete;
+    private:
+        Allocator* previous;
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        SSQ_API Allocator* getCurrentAllocator();
+        SSQ_API void setCurrentAllocator(Allocator* allocator);
+        // Defined in vm.cpp, returns the allocator of the main VM, nullptr for the default heap
+        SSQ_API Allocator* getAllocator(HSQUIRRELVM vm);
+
+        // Makes the allocator of the VM an object belongs to current while working on the object,
+        // so it doesn't matter which VM's scope is active on the thread. Only Squirrel's own memory
+        // is allocated from the current allocator, so this does nothing without SSQ_CUSTOM_ALLOCATORS
+#ifdef SSQ_CUSTOM_ALLOCATORS
+        typedef AllocatorScope ObjectAllocatorScope;
+#else
+        struct ObjectAllocatorScope {
+            explicit ObjectAllocatorScope(HSQUIRRELVM vm) {}
+        };
+#endif
+
+        // Counts the memory of a main VM and forwards to its allocator, nullptr meaning malloc
+        class SSQ_API AccountingAllocator: public Allocator {
+        public:
+            explicit AccountingAllocator(std::shared_ptr<Allocator> allocator);
+            virtual ~AccountingAllocator() override = default;
+            // Deletes the allocator once the VM is gone, or when the last of its blocks is released
+            // if objects of other VMs still hold some
+            static void release(AccountingAllocator* accounting);
+            virtual void* allocate(size_t size) override;
+            virtual void deallocate(void* ptr, size_t size) override;
+            virtual void* reallocate(void* ptr, size_t oldSize, size_t newSize) override;
+            const MemoryStats& getStats() const {
+                return stats;
+            }
+            void setLimit(size_t limit);
+            bool isOverLimit() const {
+                return overLimit;
+            }
+            // Requests a collection at the next safe point every number of allocations, 0 for never
+            void setCollectInterval(size_t allocations);
+            size_t getCollectInterval() const {
+                return collectInterval;
+            }
+            bool isCollectRequested() const {
+                return collectRequested;
+            }
+            // Called once collected, counts the interval from here
+            void resetCollect();
+            AccountingAllocator(const AccountingAllocator& other) = delete;
+            AccountingAllocator& operator = (const AccountingAllocator& other) = delete;
+        private:
+            void updateLimit();
+
+            std::shared_ptr<Allocator> allocator;
+            bool released;
+            MemoryStats stats;
+            bool overLimit;
+            size_t collectInterval;
+            size_t nextCollect;
+            bool collectRequested;
+        };
+
+        // Blocks remember the allocator they came from, so they can be released from anywhere
+        SSQ_API void* allocate(Allocator* allocator, size_t size);
+        SSQ_API void* reallocate(void* ptr, size_t size);
+        SSQ_API void deallocate(void* ptr);
+
+        template<class T, class... Args>
+        inline T* construct(HSQUIRRELVM vm, Args&&... args) {
+            void* ptr = allocate(getAllocator(vm), sizeof(T));
+            if (ptr == nullptr) {
+                throw std::bad_alloc();
+            }
+            try {
+                return new (ptr) T(std::forward<Args>(args)...);
+            } catch (...) {
+                deallocate(ptr);
+                throw;
+            }
+        }
+
+        template<class T>
+        inline void destroy(const T* ptr) {
+            if (ptr != nullptr) {
+                ptr->~T();
+                deallocate(const_cast<void*>(static_cast<const void*>(ptr)));
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "object.hpp"
+#include "args.hpp"
+
+#include <memory>
+
+namespace ssq {
+    class VM;
+    class Message;
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        struct MessageData;
+        SSQ_API Message captureMessage(HSQUIRRELVM vm, SQInteger index);
+        SSQ_API void pushMessage(HSQUIRRELVM vm, const Message& message);
+    }
+#endif
+
+    /**
+    * @brief A copy of a Squirrel value that does not belong to any VM
+    * @details A message is captured from an object and everything it contains
+    * in a single traversal, and materialised as a new object in any other VM in
+    * a single pass. It holds nulls, numbers, bools, strings, arrays, tables and
+    * copies of instances of exposed classes that are copy constructible; the class
+    * must also be added to the VM it's materialised in, otherwise the copy is
+    * passed as user data. Other types, and tables or arrays that contain themselves,
+    * cannot be captured. Objects reachable in more than one way are copied each time.
+    *
+    * The captured data is immutable and shared by all copies of a message, so a
+    * message can be copied cheaply, for example to send it to many VMs, and used
+    * from any thread. A message can be passed to and returned from functions
+    * like any other value.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Message {
+    public:
+        /**
+        * @brief Creates an empty message, which materialises as null
+        */
+        Message();
+        /**
+        * @brief Captures an object and everything it contains
+        * @throws TypeException if the object contains a value that cannot be captured
+        */
+        explicit Message(const Object& object);
+        /**
+        * @brief Creates a new object in the VM with the contents of this message
+        */
+        Object materialize(VM& vm) const;
+        /**
+        * @brief Returns true if the message is empty or holds null
+        */
+        bool isEmpty() const;
+        /**
+        * @brief Returns the type of the value captured
+        */
+        Type getType() const;
+        /**
+        * @brief Returns the number of bytes held by this message, not counting instances
+        */
+        size_t getSize() const;
+    private:
+        std::shared_ptr<const detail::MessageData> data;
+
+        friend SSQ_API Message detail::captureMessage(HSQUIRRELVM vm, SQInteger index);
+        friend SSQ_API void detail::pushMessage(HSQUIRRELVM vm, const Message& message);
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        template<>
+        inline Message popValue(HSQUIRRELVM vm, SQInteger index) {
+            return captureMessage(vm, index);
+        }
+
+        template<>
+        inline void pushValue(HSQUIRRELVM vm, const Message& value) {
+            pushMessage(vm, value);
+        }
+    }
+#endif
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "type.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace ssq {
+    /**
+    * @brief Calls of the bound native functions of one name, see VM::getNativeCallStats()
+    * @details Only recorded when simplesquirrel is built with SSQ_NATIVE_PROFILER.
+    * Functions bound with the same name, for example methods of different classes,
+    * are counted together. Constructors are counted under the name of their class.
+    * @ingroup simplesquirrel
+    */
+    struct NativeCallStats {
+        /** @brief The name the functions were bound with */
+        std::string name;
+        /** @brief Number of calls */
+        uint64_t calls;
+        /** @brief Number of calls that threw an exception */
+        uint64_t exceptions;
+        /** @brief Wall clock time of all calls in nanoseconds */
+        uint64_t totalNanoseconds;
+        /** @brief Wall clock time of the longest call in nanoseconds */
+        uint64_t maxNanoseconds;
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Counters of one bound name, owned by the main VM. Only the thread running the
+        // VM writes them, so they're plain loads and stores that can be read from anywhere
+        struct NativeCallCounters {
+            std::atomic<uint64_t> calls;
+            std::atomic<uint64_t> exceptions;
+            std::atomic<uint64_t> totalNanoseconds;
+            std::atomic<uint64_t> maxNanoseconds;
+
+            NativeCallCounters():calls(0), exceptions(0), totalNanoseconds(0), maxNanoseconds(0) {
+            }
+        };
+
+        // Returns the counters of the name in the main VM, created on first use, defined in vm.cpp
+        SSQ_API NativeCallCounters* getNativeCallCounters(HSQUIRRELVM vm, const char* name);
+
+#ifdef SSQ_NATIVE_PROFILER
+        // Times a bound native function from start() until it returns
+        class NativeCallScope {
+        public:
+            NativeCallScope():counters(nullptr), failed(false) {
+            }
+            ~NativeCallScope() {
+                if (counters == nullptr) {
+                    return;
+                }
+                const uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+                add(counters->calls, 1);
+                add(counters->totalNanoseconds, elapsed);
+                if (failed) {
+                    add(counters->exceptions, 1);
+                }
+                if (elapsed > counters->maxNanoseconds.load(std::memory_order_relaxed)) {
+                    counters->maxNanoseconds.store(elapsed, std::memory_order_relaxed);
+                }
+            }
+            template<typename P>
+            void start(const P* funcPtr) {
+                counters = funcPtr->counters;
+                begin = std::chrono::steady_clock::now();
+            }
+            void fail() {
+                failed = true;
+            }
+            NativeCallScope(const NativeCallScope& other) = delete;
+            NativeCallScope& operator = (const NativeCallScope& other) = delete;
+        private:
+            static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+                counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+
+            NativeCallCounters* counters;
+            std::chrono::steady_clock::time_point begin;
+            bool failed;
+        };
+#else
+        // Compiled out without SSQ_NATIVE_PROFILER
+        class NativeCallScope {
+        public:
+            template<typename P>
+            void start(const P*) {
+            }
+            void fail() {
+            }
+        };
+#endif
+    }
+#endif
+}
@@ -19,6 +19,12 @@
     #endif
 #endif
 
+#if !defined(SSQ_CXX17)
+    #if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+        #define SSQ_CXX17
+    #endif
+#endif
+
 #include <string>
 #include <squirrel.h>
 #include <unordered_map>
@@ -26,6 +32,7 @@
 
 #include "exceptions.hpp"
 #include "exposable_class.hpp"
+#include "memory.hpp"
 #include "type.hpp"
 
 namespace ssq {
@@ -35,6 +42,7 @@ namespace ssq {
     class Instance;
     class Table;
     class Array;
+    class Key;
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     namespace detail {
@@ -88,6 +96,11 @@ namespace ssq {
         */
         Object find(const char* name) const;
         /**
+        * @brief Finds object within this object using a pre-created key
+        * @throws NotFoundException if the object was not found
+        */
+        Object find(const Key& key) const;
+        /**
         * @brief Returns the type of the object
         */
         Type getType() const;
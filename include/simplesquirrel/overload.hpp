@@ -0,0 +1,92 @@
+#pragma once
+
+#include "binding.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /* Raw Squirrel types, one bit each in the low bits of SQObjectType */
+        static const std::size_t numOfRawTypes = 18;
+        /* An overload set is resolved with one bit per overload */
+        static const std::size_t maxOverloads = 64;
+
+        struct Overload {
+            SQFUNCTION func;
+            // Pushed in this order before calling func, as Squirrel pushes free variables
+            std::vector<HSQOBJECT> freeVars;
+        };
+
+        /* Dispatch table of the functions bound under one name, built when they're added */
+        struct OverloadSet {
+            std::string name;
+            std::vector<Overload> overloads;
+            // Overloads that take the number of parameters, indexed by the number of parameters
+            std::vector<uint64_t> byArity;
+            // Overloads that accept the raw type at the stack position, indexed by position - 1
+            std::vector<std::array<uint64_t, numOfRawTypes>> byType;
+            // Type tags of the classes the overloads take at the stack position, indexed by position - 1
+            // and then by overload, 0 if the overload doesn't look at the class of an instance there
+            std::vector<std::vector<size_t>> byClass;
+        };
+
+        struct OverloadSetPtr {
+            OverloadSet* ptr;
+        };
+
+        /* Pushes the user data of a new overload set and an array that owns the free variables */
+        SSQ_API OverloadSet& newOverloadSet(HSQUIRRELVM vm, const char* name);
+        /* Moves the free variables of the binding into the array below them and adds it to the set */
+        SSQ_API void addOverload(HSQUIRRELVM vm, OverloadSet& set, const NativeBinding& binding);
+        /* Creates the dispatching closure from the overload set and the array on the stack */
+        SSQ_API void newOverloadClosure(HSQUIRRELVM vm, const OverloadSet& set);
+
+        template<typename R, typename T, typename... Args>
+        inline std::function<R(T*, Args...)> toMethod(R(T::*memfunc)(Args...)) {
+            return std::function<R(T*, Args...)>(std::mem_fn(memfunc));
+        }
+
+        template<typename R, typename T, typename... Args>
+        inline std::function<R(T*, Args...)> toMethod(R(T::*memfunc)(Args...) const) {
+            return std::function<R(T*, Args...)>(std::mem_fn(memfunc));
+        }
+
+        template<typename F>
+        inline typename function_traits<F>::f_type toMethod(const F& func) {
+            return make_function(func);
+        }
+
+        template<typename... Funcs>
+        static void addOverloads(HSQUIRRELVM vm, const char* name, const Funcs&... funcs) {
+            static_assert(sizeof...(Funcs) <= maxOverloads, "Too many overloads of one function");
+
+            sq_pushstring(vm, name, strlen(name));
+            OverloadSet& set = newOverloadSet(vm, name);
+            int _[] = { 0, (addOverload(vm, set, bindFunc(vm, name, make_function(funcs), DefaultArgumentsImpl<>())), 0)... };
+            (void)_; // Fix unused parameter warning.
+            newOverloadClosure(vm, set);
+            if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                throw RuntimeException(vm, "Failed to bind function!");
+            }
+        }
+
+        template<typename... Funcs>
+        static void addMemberOverloads(HSQUIRRELVM vm, const char* name, const Funcs&... funcs) {
+            static_assert(sizeof...(Funcs) <= maxOverloads, "Too many overloads of one function");
+
+            sq_pushstring(vm, name, strlen(name));
+            OverloadSet& set = newOverloadSet(vm, name);
+            int _[] = { 0, (addOverload(vm, set, bindMemberFunc(vm, name, toMethod(funcs), DefaultArgumentsImpl<>())), 0)... };
+            (void)_; // Fix unused parameter warning.
+            newOverloadClosure(vm, set);
+            if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                throw RuntimeException(vm, "Failed to bind function!");
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "type.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Call stacks sampled by the debug hook of the main VM and its threads, see VM::startProfiling
+        struct SamplingProfiler {
+            std::chrono::microseconds interval;
+            std::chrono::steady_clock::time_point next;
+            uint32_t events;
+            uint64_t samples;
+            // Collapsed stacks, frames from the outermost call separated by ';', and their samples
+            std::unordered_map<std::string, uint64_t> stacks;
+
+            SamplingProfiler():interval(1000), next(), events(0), samples(0) {
+            }
+        };
+
+        // Adds the call stack of the VM to the profile, defined in profiler.cpp
+        SSQ_API void sampleCallStack(HSQUIRRELVM vm, SamplingProfiler& profiler);
+
+        // Called on every event of the debug hook, the clock is only read every 64 events
+        inline void tickProfiler(HSQUIRRELVM vm, SamplingProfiler& profiler) {
+            if ((++profiler.events & 0x3F) != 0) {
+                return;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= profiler.next) {
+                sampleCallStack(vm, profiler);
+                profiler.next = now + profiler.interval;
+            }
+        }
+    }
+#endif
+}
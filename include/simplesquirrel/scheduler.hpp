@@ -0,0 +1,204 @@
+#pragma once
+
+#include "function.hpp"
+#include "table.hpp"
+#include "interrupt.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace ssq {
+    class VM;
+
+    /**
+    * @brief Runs script functions as coroutines on Squirrel threads
+    * @details Each spawned function gets its own Squirrel thread of the main VM.
+    * update() fires due timers and resumes every thread that is ready, once.
+    * A thread gives up control by calling one of the functions added by
+    * registerFunctions():
+    * - sleep(seconds) resumes the thread after the given time, sleep(0) in the next update()
+    * - wait() resumes the thread once it's woken from C++ with wake() or notify(),
+    *   and returns the value passed to wake(), or null
+    *
+    * Threads are kept in slots reused through a free list, so spawning, waking and
+    * finishing a thread takes constant time. A thread is released as soon as its
+    * function returns, fails or it is killed. Errors of failed threads are passed to the
+    * handler set with setErrorHandler(). The Squirrel thread of a finished
+    * function stays in its slot and runs the next spawned function. The scheduler must be destroyed
+    * before the VM, and is not thread safe except for notify().
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Scheduler {
+    public:
+        /**
+        * @brief Identifies a thread of the scheduler, never reused, 0 is not a valid ID
+        */
+        typedef uint64_t ThreadId;
+        /**
+        * @brief Called with a thread that failed and its error, after the thread is released
+        */
+        typedef std::function<void(ThreadId, const RuntimeException&)> ErrorHandler;
+        /**
+        * @brief Creates a scheduler of threads with the given initial stack size
+        */
+        explicit Scheduler(VM& vm, size_t stackSize = 1024);
+        /**
+        * @brief Releases all threads
+        */
+        ~Scheduler();
+        /**
+        * @brief Adds the sleep() and wait() functions to a table, usually the root table
+        */
+        void registerFunctions(Table& table);
+        /**
+        * @brief Spawns a thread calling a function, it first runs in the next update()
+        * @throws RuntimeException if the number of arguments does not match
+        */
+        template<class... Args>
+        ThreadId spawn(const Function& func, const Object& env, Args&&... args) {
+            static const std::size_t params = sizeof...(Args);
+
+            const auto funcParams = func.getNumOfParams();
+            if (params < funcParams.first || params > funcParams.second) {
+                throw RuntimeException(nullptr, "Number of arguments does not match");
+            }
+
+            AllocatorScope scope(vm);
+            const ThreadId id = newThread();
+            HSQUIRRELVM thread = getThread(id);
+            sq_pushobject(thread, func.getRaw());
+            sq_pushobject(thread, env.getRaw());
+            detail::pushArgs(thread, std::forward<Args>(args)...);
+            start(id, params);
+            return id;
+        }
+        /**
+        * @brief Wakes a thread waiting in wait(), which returns null
+        * @details If the thread is sleeping or ready, the sleep() it is in returns the value instead.
+        * If the thread has not given up control yet, its next wait() returns immediately.
+        * @returns False if the thread does not exist anymore
+        */
+        bool wake(ThreadId id);
+        /**
+        * @brief Wakes a thread waiting in wait(), which returns the value
+        * @details If the thread is sleeping or ready, the sleep() it is in returns the value instead.
+        * If the thread has not given up control yet, its next wait() returns immediately.
+        * @returns False if the thread does not exist anymore
+        */
+        template<class T>
+        bool wake(ThreadId id, const T& value) {
+            AllocatorScope scope(vm);
+            detail::push(vm, value);
+            return wakeWithTop(id);
+        }
+        /**
+        * @brief Wakes a thread from any OS thread, for example when an asynchronous operation completes
+        * @details The thread is woken in the next update(), wait() returns null.
+        */
+        void notify(ThreadId id);
+        /**
+        * @brief Releases a thread, if it's the running one, once it gives up control
+        * @returns False if the thread does not exist anymore
+        */
+        bool kill(ThreadId id);
+        /**
+        * @brief Returns true if the thread exists
+        */
+        bool isAlive(ThreadId id) const;
+        /**
+        * @brief Returns the thread that is running, 0 if none
+        */
+        ThreadId getCurrent() const;
+        /**
+        * @brief Returns the number of threads
+        */
+        size_t getNumOfThreads() const;
+        /**
+        * @brief Sets the function called when a thread fails, errors are only printed by the VM if none is set
+        */
+        void setErrorHandler(const ErrorHandler& handler);
+        /**
+        * @brief Fires due timers and resumes all threads that are ready
+        * @details Threads made ready while updating run in the next update().
+        * @returns The number of threads resumed
+        * @throws RuntimeException if called from a thread of this scheduler, exceptions thrown
+        * by the error handler are passed on and the remaining threads run in the next update()
+        */
+        size_t update();
+        /**
+        * @brief Returns the time until the earliest timer, or max() if there are no timers
+        * @details Returns zero if any thread is ready. Useful to sleep while idle.
+        */
+        std::chrono::steady_clock::duration getTimeToNextUpdate() const;
+        /**
+        * @brief Disabled copy constructor
+        */
+        Scheduler(const Scheduler& other) = delete;
+        /**
+        * @brief Disabled copy assingment operator
+        */
+        Scheduler& operator = (const Scheduler& other) = delete;
+    private:
+        enum class State {
+            FREE,
+            READY,
+            RUNNING,
+            SLEEPING,
+            WAITING,
+            KILLED
+        };
+
+        struct Slot {
+            HSQOBJECT thread;
+            HSQOBJECT value;
+            uint32_t generation;
+            State state;
+            bool started;
+            bool pendingWake;
+            SQInteger nargs;
+            uint64_t timer;
+        };
+
+        struct Timer {
+            std::chrono::steady_clock::time_point at;
+            ThreadId id;
+            uint64_t seq;
+
+            bool operator > (const Timer& other) const {
+                return at > other.at;
+            }
+        };
+
+        ThreadId newThread();
+        HSQUIRRELVM getThread(ThreadId id) const;
+        void start(ThreadId id, SQInteger nargs);
+        bool wakeWithTop(ThreadId id);
+        Slot* find(ThreadId id);
+        const Slot* find(ThreadId id) const;
+        void resume(ThreadId id);
+        void release(ThreadId id);
+
+        static SQInteger sleepFunc(HSQUIRRELVM vm);
+        static SQInteger waitFunc(HSQUIRRELVM vm);
+        static Scheduler* getScheduler(HSQUIRRELVM vm);
+
+        HSQUIRRELVM vm;
+        size_t stackSize;
+        std::vector<Slot> slots;
+        std::vector<uint32_t> freeSlots;
+        std::deque<ThreadId> ready;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+        uint64_t timerSeq;
+        size_t numThreads;
+        ThreadId current;
+        HSQOBJECT handle;
+        std::mutex notifiedMutex;
+        std::vector<ThreadId> notified;
+        ErrorHandler errorHandler;
+    };
+}
@@ -2,6 +2,8 @@
 
 #include "object.hpp"
 
+#include <ostream>
+
 namespace ssq {
     /**
     * @brief Squirrel script object
@@ -30,6 +32,12 @@ namespace ssq {
         */
         Script(Script&& other) NOEXCEPT;
         /**
+        * @brief Writes the compiled script as bytecode into a stream
+        * @details The bytecode can be loaded back by VM::loadBytecode
+        * @throws RuntimeException if the script is empty or cannot be serialized
+        */
+        void save(std::ostream& out) const;
+        /**
         * @brief Deleted copy assignment operator
         */
         Script& operator = (const Script& other) = delete;
@@ -9,10 +9,17 @@
 #include "type.hpp"
 #include "exceptions.hpp"
 #include "object.hpp"
+#include "key.hpp"
+#include "string_ref.hpp"
 #include "function.hpp"
+#include "bound_call.hpp"
 #include "enum.hpp"
 #include "array.hpp"
+#include "buffer.hpp"
 #include "table.hpp"
 #include "instance.hpp"
 #include "script.hpp"
 #include "vm.hpp"
+#include "scheduler.hpp"
+#include "vm_pool.hpp"
+#include "message.hpp"
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "object.hpp"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <squirrel.h>
+#ifdef SSQ_CXX17
+#include <string_view>
+#endif
+
+namespace ssq {
+    /**
+    * @brief Read-only view of a Squirrel string, without a copy
+    * @details A StringRef points straight at the characters of a string owned by
+    * the VM. When a bound function takes a StringRef parameter, the string is kept
+    * alive by the call, so the view is valid until the function returns; copy it
+    * with str() to keep it any longer. Values returned from the VM, for example
+    * by VM::callFunc or Object::to, are released before they are returned, so taking
+    * them as a StringRef does not compile. A Squirrel string may contain null characters, so use size()
+    * rather than relying on the terminator.
+    * With C++17, std::string_view can be used as a parameter type as well.
+    * @ingroup simplesquirrel
+    */
+    class StringRef {
+    public:
+        /**
+        * @brief Creates an empty view
+        */
+        StringRef():ptr(nullptr), len(0) {
+        }
+        /**
+        * @brief Creates a view of the characters
+        */
+        StringRef(const SQChar* ptr, size_t len):ptr(ptr), len(len) {
+        }
+        /**
+        * @brief Returns the first character of the view
+        */
+        const SQChar* data() const {
+            return ptr;
+        }
+        /**
+        * @brief Returns the number of characters
+        */
+        size_t size() const {
+            return len;
+        }
+        /**
+        * @brief Returns true if the view has no characters
+        */
+        bool empty() const {
+            return len == 0;
+        }
+        /**
+        * @brief Returns the character at the index, which is not checked
+        */
+        SQChar operator[] (size_t index) const {
+            return ptr[index];
+        }
+        /**
+        * @brief Returns the first character of the view
+        */
+        const SQChar* begin() const {
+            return ptr;
+        }
+        /**
+        * @brief Returns the end of the view
+        */
+        const SQChar* end() const {
+            return ptr + len;
+        }
+        /**
+        * @brief Copies the characters into a new string
+        */
+        std::basic_string<SQChar> str() const {
+            return std::basic_string<SQChar>(ptr, len);
+        }
+#ifdef SSQ_CXX17
+        /**
+        * @brief Converts to string view
+        */
+        operator std::basic_string_view<SQChar> () const {
+            return std::basic_string_view<SQChar>(ptr, len);
+        }
+#endif
+        /**
+        * @brief Compares characters of two views
+        */
+        bool operator == (const StringRef& other) const {
+            return len == other.len && (len == 0 || std::char_traits<SQChar>::compare(ptr, other.ptr, len) == 0);
+        }
+        /**
+        * @brief Compares characters of two views
+        */
+        bool operator != (const StringRef& other) const {
+            return !(*this == other);
+        }
+        /**
+        * @brief Compares characters with a string
+        */
+        bool operator == (const std::basic_string<SQChar>& other) const {
+            return *this == StringRef(other.data(), other.size());
+        }
+        /**
+        * @brief Compares characters with a string
+        */
+        bool operator != (const std::basic_string<SQChar>& other) const {
+            return !(*this == other);
+        }
+        /**
+        * @brief Compares characters with a null terminated string
+        */
+        bool operator == (const SQChar* other) const {
+            return *this == StringRef(other, std::char_traits<SQChar>::length(other));
+        }
+        /**
+        * @brief Compares characters with a null terminated string
+        */
+        bool operator != (const SQChar* other) const {
+            return !(*this == other);
+        }
+    private:
+        const SQChar* ptr;
+        size_t len;
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /* Views into strings of the VM, only valid as parameters of bound functions */
+        template<typename T>
+        struct is_string_view: std::false_type {
+        };
+
+        template<typename T>
+        struct is_string_view<const T>: is_string_view<T> {
+        };
+
+        template<>
+        struct is_string_view<StringRef>: std::true_type {
+        };
+
+#ifdef SSQ_CXX17
+        template<>
+        struct is_string_view<std::basic_string_view<SQChar>>: std::true_type {
+        };
+#endif
+    }
+#endif
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "class.hpp"
+#include "key.hpp"
 
 #include <string>
 #include <vector>
@@ -69,6 +70,7 @@ namespace ssq {
         template<typename T, typename... Args, typename... DefaultArgs>
         Class addClass(const char* name, const std::function<T*(Args...)>& allocator = std::bind(&detail::defaultClassAllocator<T>),
                        DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}, bool release = true, Class base = Class()) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_pushobject(vm, obj);
             Class cls(detail::addClass(vm, name, allocator, std::move(defaultArgs), base.getRaw(), release));
             sq_pop(vm, 1);
@@ -99,6 +101,7 @@ namespace ssq {
         */
         template<typename T>
         Class addAbstractClass(const char* name, Class base = Class()) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_pushobject(vm, obj);
             Class cls(detail::addAbstractClass<T>(vm, name, base.getRaw()));
             sq_pop(vm, 1);
@@ -110,6 +113,7 @@ namespace ssq {
         */
         template<typename R, typename... Args, typename... DefaultArgs>
         Function addFunc(const char* name, const std::function<R(Args...)>& func, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}){
+            detail::ObjectAllocatorScope scope(vm);
             Function ret(vm);
             sq_pushobject(vm, obj);
             detail::addFunc(vm, name, func, std::move(defaultArgs));
@@ -124,11 +128,55 @@ namespace ssq {
         Function addFunc(const char* name, const F& lambda, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}) {
             return addFunc(name, detail::make_function(lambda), std::move(defaultArgs));
         }
+        /**
+        * @brief Adds a new function type to this table, bound to a function pointer
+        * known at compile time
+        * @details The native trampoline calls the function directly, without
+        * std::function or a function userdata. Usage: addFunc<decltype(&f), &f>("f")
+        * @returns Function object that references the added function
+        */
+        template<typename F, F func, typename... DefaultArgs>
+        Function addFunc(const char* name, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}) {
+            detail::ObjectAllocatorScope scope(vm);
+            Function ret(vm);
+            sq_pushobject(vm, obj);
+            detail::addStaticFunc<detail::StaticFunc<F, func>>(vm, name, std::move(defaultArgs));
+            sq_pop(vm, 1);
+            return ret;
+        }
+#ifdef SSQ_CXX17
+        /**
+        * @brief Adds a new function type to this table, bound to a function pointer
+        * known at compile time. Usage: addFunc<&f>("f")
+        * @returns Function object that references the added function
+        */
+        template<auto func, typename... DefaultArgs>
+        Function addFunc(const char* name, DefaultArgumentsImpl<DefaultArgs...> defaultArgs = {}) {
+            return addFunc<decltype(func), func>(name, std::move(defaultArgs));
+        }
+#endif
+        /**
+        * @brief Adds several functions under one name, the one called is picked by the arguments
+        * @details The functions are function pointers, std::function or lambdas. If more
+        * of them accept the arguments of a call, the first one wins. Usage:
+        * addOverloads("print", &printInt, &printStr)
+        * @returns Function object that references the added function
+        */
+        template<typename... Funcs>
+        Function addOverloads(const char* name, const Funcs&... funcs) {
+            detail::ObjectAllocatorScope scope(vm);
+            Function ret(vm);
+            sq_pushobject(vm, obj);
+            detail::addOverloads(vm, name, funcs...);
+            sq_pop(vm, 1);
+            return ret;
+        }
         /**
          * @brief Adds a new key-value pair to this table
          */
         template<typename T>
         inline void set(const char* name, const T& value) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_pushobject(vm, obj);
             sq_pushstring(vm, name, strlen(name));
             detail::push<T>(vm, value);
@@ -137,6 +185,20 @@ namespace ssq {
             }
             sq_pop(vm,1); // pop table
         }
+        /**
+         * @brief Adds a new key-value pair to this table using a pre-created key
+         */
+        template<typename T>
+        inline void set(const Key& key, const T& value) {
+            detail::ObjectAllocatorScope scope(vm);
+            sq_pushobject(vm, obj);
+            sq_pushobject(vm, key.getRaw());
+            detail::push<T>(vm, value);
+            if (SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                throw RuntimeException(vm, "Cannot add entry '" + key.getName() + "' to table!");
+            }
+            sq_pop(vm,1); // pop table
+        }
         /**
          * @brief Returns the value of an entry
          * @throws NotFoundException if an entry with the provided key does not exist
@@ -145,6 +207,29 @@ namespace ssq {
         inline T get(const char* name) const {
             return find(name).to<T>();
         }
+        /**
+         * @brief Returns the value of an entry using a pre-created key
+         * @details The value is read directly from the stack
+         * @throws NotFoundException if an entry with the provided key does not exist
+         */
+        template<typename T>
+        inline T get(const Key& key) const {
+            static_assert(!detail::is_string_view<T>::value, "A string view cannot outlive the call it's passed to, use std::string");
+            sq_pushobject(vm, obj);
+            sq_pushobject(vm, key.getRaw());
+            if (SQ_FAILED(sq_get(vm, -2))) {
+                sq_pop(vm, 1);
+                throw NotFoundException(vm, key.getName());
+            }
+            try {
+                T ret(detail::pop<T>(vm, -1));
+                sq_pop(vm, 2);
+                return ret;
+            } catch (...) {
+                sq_pop(vm, 2);
+                std::rethrow_exception(std::current_exception());
+            }
+        }
         /**
          * @brief Provides the value of an entry, if it exists
          * @returns Whether an entry with the provided key was found
@@ -159,10 +244,28 @@ namespace ssq {
                 return false;
             }
         }
+        /**
+         * @brief Provides the value of an entry using a pre-created key, if it exists
+         * @returns Whether an entry with the provided key was found
+         */
+        template<typename T>
+        inline bool get(const Key& key, T& value) const {
+            try {
+                value = get<T>(key);
+                return true;
+            }
+            catch (const NotFoundException&) {
+                return false;
+            }
+        }
         /**
          * @brief Returns whether an entry with the provided key exists
          */
         bool hasEntry(const char* name) const;
+        /**
+         * @brief Returns whether an entry with the provided pre-created key exists
+         */
+        bool hasEntry(const Key& key) const;
         /**
          * @brief Changes the key of an entry with a new one
          * @throws RuntimeException if either deleting the old entry, or creating the new one, fails
@@ -172,6 +275,10 @@ namespace ssq {
          * @brief Removes an entry from this table
          */
         void remove(const char* name);
+        /**
+         * @brief Removes an entry from this table using a pre-created key
+         */
+        void remove(const Key& key);
         /**
          * @brief Removes all entries from this table
          */
@@ -197,6 +304,7 @@ namespace ssq {
          */
         template<typename T>
         std::map<std::string, T> convert() const {
+            static_assert(!detail::is_string_view<T>::value, "A string view cannot outlive the call it's passed to, use std::string");
             const SQInteger old_top = sq_gettop(vm);
             sq_pushobject(vm, obj);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "object.hpp"
+#include "string_ref.hpp"
 
 #include <functional>
 
@@ -70,14 +71,22 @@ namespace ssq {
         }
 
 
+        struct NativeCallCounters;
+
         template<class Ret>
         struct FuncPtr {
             const std::function<Ret()>* ptr;
+#ifdef SSQ_NATIVE_PROFILER
+            NativeCallCounters* counters;
+#endif
         };
 
         template<class Ret, typename... Args>
         struct FuncPtr<Ret(Args...)> {
             const std::function<Ret(Args...)>* ptr;
+#ifdef SSQ_NATIVE_PROFILER
+            NativeCallCounters* counters;
+#endif
         };
 
         template<typename... Args>
@@ -91,6 +100,7 @@ namespace ssq {
      */
     template<typename T>
     inline T Object::to() const {
+        static_assert(!detail::is_string_view<T>::value, "A string view cannot outlive the call it's passed to, use std::string");
         sq_pushobject(vm, obj);
         try {
             auto ret = detail::pop<T>(vm, -1);
@@ -8,8 +8,15 @@
 #include "instance.hpp"
 #include "function.hpp"
 #include "array.hpp"
+#include "class_registry.hpp"
+#include "memory.hpp"
+#include "interrupt.hpp"
+#include "native_stats.hpp"
+#include "profiler.hpp"
 
 #include <memory>
+#include <unordered_map>
+#include <istream>
 
 #ifdef _MSC_VER
 #pragma warning( push )
@@ -44,6 +51,7 @@ namespace ssq {
         MATH = 0x0004,
         SYSTEM = 0x0008,
         STRING = 0x0010,
+        BUFFER = 0x0020,
         ALL = 0xFFFF
       };
     }
@@ -74,6 +82,15 @@ namespace ssq {
         */
         VM(size_t stackSize, uint32_t flags = Libs::NONE);
         /**
+        * @brief Creates a VM with a fixed stack size, allocating from the given allocator
+        * @details The allocator is shared by the VM and all of its threads, and is
+        * kept alive until the VM is destroyed. It's used for the copies of functions,
+        * default arguments and values pushed by copy. When simplesquirrel is built
+        * with SSQ_CUSTOM_ALLOCATORS, it's also used for the memory of Squirrel
+        * itself, see AllocatorScope. A nullptr allocator means the default heap.
+        */
+        VM(size_t stackSize, uint32_t flags, std::shared_ptr<Allocator> allocator);
+        /**
         * @brief Destroys the VM and all of this objects
         */
         void destroy();
@@ -94,6 +111,178 @@ namespace ssq {
         */
         VM(VM&& other) NOEXCEPT;
         /**
+        * @brief Returns the allocator of this VM, nullptr for the default heap
+        */
+        Allocator* getAllocator() const;
+        /**
+        * @brief Returns the memory usage of this VM and all of its threads
+        * @details Only the memory allocated while the allocator of the VM is current
+        * is counted, see AllocatorScope.
+        * @throws RuntimeException if simplesquirrel is built without SSQ_CUSTOM_ALLOCATORS,
+        * where the memory of Squirrel can't be counted
+        */
+        MemoryStats getMemoryStats() const;
+        /**
+        * @brief Limits the memory of this VM and all of its threads, 0 for no limit
+        * @details Squirrel cannot recover from a failed allocation, so allocations
+        * past the limit still succeed, and the script is stopped at the next safe point
+        * with a Squirrel error. Safe points are calls to native functions bound by
+        * simplesquirrel, and with the patched Squirrel of SSQ_SQUIRREL_INTERRUPT, every
+        * line and loop iteration of the script. The script can catch the error once per
+        * call from C++ to free memory, any allocation past the limit after that stops it
+        * for good. run() and callFunc() throw while the VM is over the limit. Setting a
+        * limit enables debug info for the scripts compiled from then on, scripts compiled
+        * before are only stopped at their loops and calls. The limit uses the debug hook
+        * of the VM while a call is running, see setNativeDebugHook().
+        * @throws RuntimeException if simplesquirrel is built without SSQ_CUSTOM_ALLOCATORS
+        */
+        void setMemoryLimit(size_t bytes);
+        /**
+        * @brief Sets the native debug hook of this VM, nullptr to remove it
+        * @details Execution budgets, memory limits and the profiler replace the debug
+        * hook of the VM while a call from C++ is running. A hook set here is still called
+        * during the call, and set again once it returns. A hook set directly with
+        * sq_setnativedebughook() or sq_setdebughook() is lost instead.
+        */
+        void setNativeDebugHook(SQDEBUGHOOK hook);
+        /**
+        * @brief Returns the native debug hook set with setNativeDebugHook()
+        */
+        SQDEBUGHOOK getNativeDebugHook() const;
+        /**
+        * @brief Sets whether scripts compiled from now on get debug info, such as line numbers
+        * @details Execution budgets, memory limits, garbage collection intervals and the
+        * profiler turn debug info on while they're set. Once none of them is set, this
+        * setting is restored. Setting it directly with sq_enabledebuginfo() is not kept.
+        * Disabled by default, as in Squirrel.
+        */
+        void setDebugInfo(bool enable);
+        /**
+        * @brief Returns the debug info setting made with setDebugInfo()
+        */
+        bool isDebugInfoEnabled() const;
+        /**
+        * @brief Sets the execution budget of each call into this VM or its threads from C++
+        * @details When a script runs out of its budget, a Squirrel error is raised at
+        * the next safe point and at every one after it. Unless the script catches it,
+        * the run() or callFunc() that started it then throws, and getStopReason() tells
+        * why. Safe points are every line and loop iteration of the script when Squirrel
+        * is patched by the SSQ_SQUIRREL_INTERRUPT CMake option, so even while (true) {}
+        * is stopped, and ExecutionBudget::uncatchable makes the error skip the try blocks
+        * of scripts. Without the patch, stopping is cooperative: only calls to native
+        * functions bound by simplesquirrel raise the error, and a script that never
+        * calls one is not stopped. The budget uses the debug hook of the VM while a
+        * call is running, a hook set with setNativeDebugHook() is still called.
+        * A budget of zeros disables it (the default).
+        */
+        void setExecutionBudget(const ExecutionBudget& budget);
+        /**
+        * @brief Returns the execution budget
+        */
+        const ExecutionBudget& getExecutionBudget() const;
+        /**
+        * @brief Returns why the last call into this VM from C++ was stopped
+        * @details StopReason::NONE if it wasn't stopped.
+        */
+        StopReason getStopReason() const;
+        /**
+        * @brief Runs the garbage collector now, even if collections are paused
+        * @details Freeing objects from reference cycles takes a full pass over all
+        * objects of the VM, so it's best done when there is time for it.
+        * @returns The number of objects freed
+        */
+        size_t collectGarbage();
+        /**
+        * @brief Collects garbage at the next safe point after every number of allocations
+        * @details Safe points are calls into the VM from C++ that are not made from a
+        * native function, and with SSQ_SQUIRREL_INTERRUPT also line events and loop
+        * iterations of scripts. Calls to native functions bound by simplesquirrel are not,
+        * as the values they have popped may only be referenced by them. Only allocations
+        * counted by getMemoryStats() count. 0 disables it (the default).
+        * @throws RuntimeException if simplesquirrel is built without SSQ_CUSTOM_ALLOCATORS,
+        * as the allocations of scripts are not counted then
+        */
+        void setGarbageCollectionInterval(size_t allocations);
+        /**
+        * @brief Returns the number of allocations between collections, 0 if disabled
+        */
+        size_t getGarbageCollectionInterval() const;
+        /**
+        * @brief Collects garbage if there were at least minAllocations allocations since the last collection
+        * @details Meant to be called while the application is idle, for example between
+        * frames, to move collections out of latency-sensitive work. Does nothing while
+        * collections are paused. Without SSQ_CUSTOM_ALLOCATORS the allocations of scripts
+        * are not counted, so it collects every time it's called while not paused.
+        * @returns True if the garbage collector ran
+        */
+        bool collectGarbageAtIdle(size_t minAllocations = 1);
+        /**
+        * @brief Pauses automatic collections, for example during a critical section
+        * @details Pauses can be nested. Collections requested by the allocation
+        * interval while paused run when the last pause is resumed.
+        * Only collectGarbage() collects while paused.
+        */
+        void pauseGarbageCollection();
+        /**
+        * @brief Resumes automatic collections paused by pauseGarbageCollection()
+        */
+        void resumeGarbageCollection();
+        /**
+        * @brief Returns true if automatic collections are paused
+        */
+        bool isGarbageCollectionPaused() const;
+        /**
+        * @brief Returns the number of collections, objects freed and time spent collecting
+        */
+        const GarbageCollectionStats& getGarbageCollectionStats() const;
+        /**
+        * @brief Returns the calls of bound native functions, one entry per bound name
+        * @details Calls are only counted when simplesquirrel is built with
+        * SSQ_NATIVE_PROFILER, otherwise the list is empty. Functions bound at compile
+        * time with addFunc<&func>() are not counted. Can be called from another
+        * thread while scripts run, but not while functions are being bound.
+        */
+        std::vector<NativeCallStats> getNativeCallStats() const;
+        /**
+        * @brief Sets all counters of bound native functions to zero
+        */
+        void resetNativeCallStats();
+        /**
+        * @brief Starts sampling the call stacks of scripts run in this VM and its threads
+        * @details Samples are taken while run(), runAndReturn() or callFunc() runs
+        * a script, by the debug hook of the VM, which replaces any other native debug
+        * hook during those calls. The hook only reads the clock every 64 events, and
+        * the call stack is only walked once per interval. Scripts compiled while profiling
+        * get debug info, so samples tell the line being run. Samples taken before
+        * are kept.
+        * @param intervalMicroseconds Time between samples
+        */
+        void startProfiling(uint64_t intervalMicroseconds = 1000);
+        /**
+        * @brief Stops sampling, keeping the samples taken
+        * @details Debug info is set back as described by setDebugInfo().
+        */
+        void stopProfiling();
+        /**
+        * @brief Returns true if call stacks are being sampled
+        */
+        bool isProfiling() const;
+        /**
+        * @brief Returns the number of samples taken
+        */
+        uint64_t getNumOfProfileSamples() const;
+        /**
+        * @brief Writes the samples as collapsed stacks, one line per distinct call stack
+        * @details Each line lists the frames from the outermost call, formatted as
+        * source:function:line and separated by semicolons, followed by a space and the
+        * number of samples. This is the input of flamegraph.pl and speedscope.
+        */
+        void writeCollapsedStacks(std::ostream& out) const;
+        /**
+        * @brief Discards all samples
+        */
+        void resetProfile();
+        /**
         * @brief Registers standard template libraries
         */
         void registerStdlib(uint32_t flags);
@@ -180,6 +369,39 @@ namespace ssq {
         */
         Script compileFile(const char* path);
         /**
+        * @brief Compiles a script from a source file mapped into memory
+        * @details The file is mapped read-only and handed to the compiler as
+        * a single buffer, without being copied. Bytecode and UCS-2 files
+        * are loaded the same way as compileFile does. This does not use
+        * the compile cache. The file must not be truncated while compiling.
+        * @throws CompileException
+        */
+        Script compileFileMapped(const char* path);
+        /**
+        * @brief Loads a script from bytecode written by Script::save
+        * @throws CompileException if the bytecode cannot be read
+        */
+        Script loadBytecode(std::istream& in);
+        /**
+        * @brief Sets the directory of the compile cache, used by compileFile
+        * @details When set, compileFile hashes the contents of the source file
+        * and looks up precompiled bytecode in this directory. If it's not there,
+        * the source is compiled and its bytecode is stored in the directory.
+        * The directory must exist. An empty path disables the cache (the default).
+        * The cache is shared by the main VM and all of its threads.
+        */
+        void setCompileCache(const std::string& directory);
+        /**
+        * @brief Returns the directory of the compile cache, empty if disabled
+        */
+        const std::string& getCompileCache() const;
+        /**
+        * @brief Returns the file compileFile caches the bytecode of a source file in
+        * @details The name depends on the contents of the source file, so it changes
+        * with them. Empty if the cache is disabled or the file is not plain source.
+        */
+        std::string getCompileCacheFile(const char* path) const;
+        /**
         * @brief Runs a script
         * @details When the script runs for the first time, the contens such as
         * class definitions are assigned to the root table (global table).
@@ -196,14 +418,16 @@ namespace ssq {
         Object runAndReturn(const Script& script, bool printCallstack = false);
         /**
         * @brief Calls a global function
+        * @details The return value is read directly from the stack as type R,
+        * which is Object by default and can be void. For example: callFunc<int>(func, vm, 1, 2)
         * @param func The instance of a function
         * @param args Any number of arguments
         * @throws RuntimeException if an exception is thrown or number of arguments
         * do not match
         * @throws TypeException if casting from Squirrel objects to C++ objects failed
         */
-        template<class... Args>
-        Object callFunc(const Function& func, const Object& env, Args&&... args) const {
+        template<class R = Object, class... Args>
+        R callFunc(const Function& func, const Object& env, Args&&... args) const {
             static const std::size_t params = sizeof...(Args);
 
             const auto funcParams = func.getNumOfParams();
@@ -211,13 +435,16 @@ namespace ssq {
                 throw RuntimeException(nullptr, "Number of arguments does not match");
             }
 
+            detail::ExecutionScope execution(vm);
+            detail::checkInterrupt(vm, detail::SafePoint::CALL_FROM_CPP);
+            AllocatorScope scope(vm);
             auto top = sq_gettop(vm);
             sq_pushobject(vm, func.getRaw());
             sq_pushobject(vm, env.getRaw());
 
-            pushArgs(std::forward<Args>(args)...);
+            detail::pushArgs(vm, std::forward<Args>(args)...);
 
-            return callAndReturn(params, top);
+            return detail::callPushedAndPop<R>(vm, params, top);
         }
         /**
         * @brief Creates a new instance of class and call constructor with given arguments
@@ -229,7 +456,7 @@ namespace ssq {
         Instance newInstance(const Class& cls, Args&&... args) const {
             Instance inst = newInstanceNoCtor(cls);
             Function ctor = cls.findFunc("constructor");
-            callFunc(ctor, inst, std::forward<Args>(args)...);
+            callFunc<void>(ctor, inst, std::forward<Args>(args)...);
             return inst;
         }
         /**
@@ -238,6 +465,7 @@ namespace ssq {
         * @throws RuntimeException
         */
         Instance newInstanceNoCtor(const Class& cls) const {
+            detail::ObjectAllocatorScope scope(vm);
             Instance inst(vm);
             sq_pushobject(vm, cls.getRaw());
             if (SQ_FAILED(sq_createinstance(vm, -1)))
@@ -257,6 +485,7 @@ namespace ssq {
         * @throws RuntimeException
         */
         Instance newInstancePtr(Table& table, const Class& cls, const char* name, ExposableClass* ptr) const {
+            detail::ObjectAllocatorScope scope(vm);
             const SQInteger old_top = sq_gettop(vm);
             sq_pushobject(vm, table.getRaw());
 
@@ -277,15 +506,34 @@ namespace ssq {
         }
         /**
         * @brief Creates a new thread with a fixed stack size
+        * @details The stack size is rounded up to a power of two, its stack-size class.
+        * A thread of the same class is taken from the thread pool if there is one.
         * @param stackSize The stack size of the new thread
         */
         VM newThread(size_t stackSize);
         /**
         * @brief Destroy a thread created from this main VM
+        * @details An idle thread is reset and returned to the thread pool of its
+        * stack-size class, unless the pool is full. This does not run the garbage
+        * collector, objects kept alive by reference cycles through the thread are
+        * freed by the next collection.
         * @param threadVM Reference to the thread VM object to be destroyed
         */
         void destroyThread(VM& threadVM);
         /**
+        * @brief Sets the number of destroyed threads kept for reuse per stack-size class
+        * @details 0 disables the thread pool. Defaults to 16.
+        */
+        void setThreadPoolSize(size_t size);
+        /**
+        * @brief Returns the number of destroyed threads kept for reuse per stack-size class
+        */
+        size_t getThreadPoolSize() const;
+        /**
+        * @brief Returns the number of threads waiting in the thread pool
+        */
+        size_t getNumOfPooledThreads() const;
+        /**
         * @brief Creates a new empty table
         */
         Table newTable() const {
@@ -298,12 +546,25 @@ namespace ssq {
             return Array(vm);
         }
         /**
+        * @brief Creates a new pre-created key for repeated lookups
+        */
+        Key newKey(const char* name) const {
+            return Key(vm, name);
+        }
+        /**
         * @brief Creates a new array
         */
         template<class T>
         Array newArray(const std::vector<T>& vector) const {
             return Array(vm, vector);
         }
+        /**
+        * @brief Creates a new array out of contiguous numbers or bools
+        */
+        template<class T>
+        Array newArray(const T* data, size_t count) const {
+            return Array(vm, data, count);
+        }
         /**
          * @brief Adds a new enum to this table
          */
@@ -313,6 +574,7 @@ namespace ssq {
          */
         template<typename T>
         inline void setConst(const char* name, const T& value) {
+            detail::ObjectAllocatorScope scope(vm);
             sq_pushconsttable(vm);
             sq_pushstring(vm, name, strlen(name));
             detail::push<T>(vm, value);
@@ -327,12 +589,14 @@ namespace ssq {
         void debugStack() const;
         /**
         * @brief Add registered class object into the table of known classes
+        * @note Classes are registered per main VM and shared with its threads
         */
-        static void addClassObj(size_t hashCode, const HSQOBJECT& obj);
+        void addClassObj(size_t hashCode, const HSQOBJECT& obj);
         /**
         * @brief Get registered class object from hash code
+        * @throws std::out_of_range if no class is registered for the hash code
         */
-        static const HSQOBJECT& getClassObj(size_t hashCode);
+        const HSQOBJECT& getClassObj(size_t hashCode) const;
         /**
         * @brief Copy assingment operator
         */
@@ -342,9 +606,35 @@ namespace ssq {
         */
         VM& operator = (VM&& other) NOEXCEPT;
     private:
-        static std::unordered_map<size_t, HSQOBJECT> classMap;
+        friend const detail::ClassRegistry* detail::getClassRegistry(HSQUIRRELVM vm);
+        friend Allocator* detail::getAllocator(HSQUIRRELVM vm);
+        friend const char* detail::getInterrupt(HSQUIRRELVM vm, detail::SafePoint point);
+        friend SQInteger detail::interruptExecution(HSQUIRRELVM vm, SQInteger point);
+        friend detail::ExecutionState* detail::getExecutionState(HSQUIRRELVM vm);
+        friend detail::NativeCallCounters* detail::getNativeCallCounters(HSQUIRRELVM vm, const char* name);
+        friend const Key& detail::getVarTableKey(HSQUIRRELVM vm, bool set);
+
+        detail::ClassRegistry classRegistry; // Only used in the main VM
+        Key varGetKey; // Only used in the main VM, looks up the "_get" table of classes
+        Key varSetKey; // Only used in the main VM, looks up the "_set" table of classes
+        struct ThreadEntry {
+            HSQOBJECT obj;
+            size_t stackSize;
+        };
 
-        std::vector<HSQOBJECT> threads; // Only used in the main VM
+        std::unordered_map<HSQUIRRELVM, ThreadEntry> threads; // Only used in the main VM
+        std::unordered_map<size_t, std::vector<HSQOBJECT>> threadPool; // Only used in the main VM
+        size_t threadPoolSize; // Only used in the main VM
+        std::string compileCacheDir; // Only used in the main VM
+        std::shared_ptr<Allocator> allocator; // Only used in the main VM
+        std::unique_ptr<detail::AccountingAllocator> accounting; // Only used in the main VM
+        detail::ExecutionState execution; // Only used in the main VM
+        GarbageCollectionStats gcStats; // Only used in the main VM
+        size_t gcPauses; // Only used in the main VM
+        size_t gcAllocations; // Only used in the main VM, allocations at the last collection
+        bool debugInfo; // Only used in the main VM, set with setDebugInfo
+        std::unordered_map<std::string, detail::NativeCallCounters> nativeCalls; // Only used in the main VM
+        std::unique_ptr<detail::SamplingProfiler> profiler; // Only used in the main VM, kept after profiling stops
         //std::unique_ptr<CompileException> compileException;
         //std::unique_ptr<RuntimeException> runtimeException;
         void* foreignPtr;
@@ -353,22 +643,56 @@ namespace ssq {
         * @brief Creates a VM object for a thread
         */
         VM(const HSQOBJECT& threadObj);
+        /**
+        * @brief Resets a thread for reuse, or releases it if the pool is full
+        */
+        void recycleThread(ThreadEntry& entry);
 
-        static void pushArgs();
-
-        template <class First, class... Rest> 
-        void pushArgs(First&& first, Rest&&... rest) const {
-            detail::push(vm, first);
-            pushArgs(std::forward<Rest>(rest)...);
-        }
-
-        Object callAndReturn(SQUnsignedInteger nparams, SQInteger top) const;
+        /**
+        * @brief Runs a collection requested by the allocation interval, unless paused
+        */
+        void collectRequestedGarbage();
+        /**
+        * @brief Enables debug info while the user or a budget, limit or the profiler needs it
+        */
+        void updateDebugInfo();
+        /**
+        * @brief Counts this VM in detail::numOfInterruptibleVMs while it has a budget, limit or collection interval
+        */
+        void updateInterruptible();
 
         static void defaultPrintFunc(HSQUIRRELVM vm, const SQChar *s, ...);
         static void defaultErrorFunc(HSQUIRRELVM vm, const SQChar *s, ...);
         //static SQInteger defaultRuntimeErrorFunc(HSQUIRRELVM vm);
         //static void defaultCompilerErrorFunc(HSQUIRRELVM vm, const SQChar* desc, const SQChar* source, SQInteger line, SQInteger column);
     };
+
+    /**
+    * @brief Pauses the automatic garbage collections of a VM while in scope
+    * @see VM::pauseGarbageCollection
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API GarbageCollectionPause {
+    public:
+        /**
+        * @brief Pauses the collections of the VM
+        */
+        explicit GarbageCollectionPause(VM& vm);
+        /**
+        * @brief Resumes the collections of the VM
+        */
+        ~GarbageCollectionPause();
+        /**
+        * @brief Disabled copy constructor
+        */
+        GarbageCollectionPause(const GarbageCollectionPause& other) = delete;
+        /**
+        * @brief Disabled copy assingment operator
+        */
+        GarbageCollectionPause& operator = (const GarbageCollectionPause& other) = delete;
+    private:
+        VM& vm;
+    };
 }
 
 #ifdef _MSC_VER
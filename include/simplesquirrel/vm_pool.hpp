@@ -0,0 +1,169 @@
+#pragma once
+
+#include "vm.hpp"
+#include "util.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4251 )
+#endif
+
+namespace ssq {
+    /**
+    * @brief Runs jobs on a fixed number of worker threads, each with its own VM
+    * @details A VM is not thread safe, so instead of sharing one VM behind a lock,
+    * every worker owns an isolated main VM. All VMs are set up the same way: the
+    * setup function binds functions and classes, then the script is loaded from
+    * its bytecode and run. Jobs are queued on the deque of one worker, and idle
+    * workers steal jobs from the others, so a worker is never idle while there is
+    * work queued anywhere.
+    *
+    * Objects of one VM cannot be used from another VM, so arguments and results
+    * of jobs should be plain C++ values. The pool can be used from any thread.
+    * A job waiting for the result of another job of the same pool must use get(),
+    * as std::future::get() blocks its worker, which may be the only one that
+    * could run the awaited job.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API VMPool {
+    public:
+        /**
+        * @brief Called with each VM of the pool before the script runs in it
+        */
+        typedef std::function<void(VM&)> Setup;
+        /**
+        * @brief Creates the VMs and starts the workers
+        * @param numWorkers The number of workers and VMs, 0 for the number of cores
+        * @param script The script run in every VM, compiled once
+        * @param setup Called with each VM before the script runs, can be empty
+        * @param stackSize The stack size of each VM
+        * @param flags The standard libraries registered in each VM
+        * @throws CompileException if the script cannot be loaded
+        * @throws RuntimeException if the script or setup fails
+        */
+        VMPool(size_t numWorkers, const Script& script, const Setup& setup = Setup(),
+            size_t stackSize = 1024, uint32_t flags = Libs::NONE);
+        /**
+        * @brief Runs all queued jobs, then stops the workers and destroys the VMs
+        */
+        ~VMPool();
+        /**
+        * @brief Queues a job that is called with the VM of the worker running it
+        * @returns The future result of the job, which rethrows any exception it threw
+        * @throws RuntimeException if the pool is being destroyed
+        */
+        template<class F>
+        auto submit(F func) -> std::future<decltype(func(std::declval<VM&>()))> {
+            typedef decltype(func(std::declval<VM&>())) R;
+            auto task = std::make_shared<std::packaged_task<R(VM&)>>(std::move(func));
+            std::future<R> result = task->get_future();
+            push([task](VM& vm) {
+                (*task)(vm);
+            });
+            return result;
+        }
+        /**
+        * @brief Queues a call of a global function of the script
+        * @details The arguments are copied and passed to VM::callFunc, whose
+        * result is converted to R, void by default.
+        * @returns The future result of the call
+        * @throws RuntimeException if the pool is being destroyed
+        */
+        template<class R = void, class... Args>
+        std::future<R> call(const std::string& name, Args&&... args) {
+            typedef std::tuple<typename std::decay<Args>::type...> Tuple;
+            auto params = std::make_shared<Tuple>(std::forward<Args>(args)...);
+            return submit([name, params](VM& vm) -> R {
+                return callImpl<R>(vm, name, *params, detail::index_range<0, sizeof...(Args)>());
+            });
+        }
+        /**
+        * @brief Waits for the result of a job and returns it
+        * @details Called from a worker of this pool, the worker runs queued jobs
+        * while it waits, so a job can wait for jobs it queued even with one worker.
+        * When none is queued, it sleeps until a job is queued or finished.
+        * From any other thread, it's the same as future.get().
+        * @returns The result of the job, or rethrows the exception it threw
+        */
+        template<class R>
+        R get(std::future<R>& future) {
+            if (isWorker()) {
+                runUntil([&future]() {
+                    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                });
+            }
+            return future.get();
+        }
+        /**
+        * @brief Returns the number of workers
+        */
+        size_t getNumOfWorkers() const;
+        /**
+        * @brief Returns the number of jobs queued and not yet started
+        */
+        size_t getNumOfPendingJobs() const;
+        /**
+        * @brief Disabled copy constructor
+        */
+        VMPool(const VMPool& other) = delete;
+        /**
+        * @brief Disabled copy assingment operator
+        */
+        VMPool& operator = (const VMPool& other) = delete;
+    private:
+        typedef std::function<void(VM&)> Job;
+
+        struct Worker {
+            VM vm;
+            std::mutex mutex;
+            std::deque<Job> jobs;
+            std::thread thread;
+
+            Worker(size_t stackSize, uint32_t flags):vm(stackSize, flags) {
+            }
+        };
+
+        template<class R, class Tuple, int... Is>
+        static R callImpl(VM& vm, const std::string& name, Tuple& params, detail::index_list<Is...>) {
+            return vm.callFunc<R>(vm.findFunc(name.c_str()), vm, std::get<Is>(params)...);
+        }
+
+        bool isWorker() const;
+        bool runQueuedJob();
+        void runUntil(const std::function<bool()>& ready);
+        void runJob(Job& job, VM& vm);
+        void push(Job job);
+        bool pop(size_t index, Job& job);
+        bool steal(size_t index, Job& job);
+        void run(size_t index);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<size_t> next;
+        std::atomic<size_t> pending;
+        std::atomic<uint64_t> pushed; // Jobs ever queued, a change wakes sleeping workers
+        std::atomic<uint64_t> completed; // Jobs ever finished, a change wakes waiting workers
+        std::atomic<size_t> sleeping;
+        std::atomic<size_t> waiting; // Workers blocked in get()
+        std::atomic<bool> stopping;
+        std::mutex idleMutex;
+        std::condition_variable idle;
+        std::condition_variable done;
+    };
+}
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
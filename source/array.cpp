@@ -5,6 +5,7 @@
 
 namespace ssq {
     Array::Array(HSQUIRRELVM vm, size_t len):Object(vm) {
+        detail::ObjectAllocatorScope scope(vm);
         sq_newarray(vm, len);
         sq_getstackobj(vm, -1, &obj);
         sq_addref(vm, &obj);
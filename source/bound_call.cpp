@@ -0,0 +1,40 @@
+#include "simplesquirrel/bound_call.hpp"
+#include "simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+
+namespace ssq {
+    BoundCall::BoundCall():vm(nullptr), func(), env(), minParams(0), maxParams(0) {
+
+    }
+
+    BoundCall::BoundCall(const Function& func, const Object& env):vm(func.getHandle()), func(func), env(env),
+        minParams(0), maxParams(0) {
+        if (vm == nullptr) throw RuntimeException(nullptr, "VM is not initialised");
+        const auto params = func.getNumOfParams();
+        minParams = params.first;
+        maxParams = params.second;
+    }
+
+    bool BoundCall::isEmpty() const {
+        return func.isEmpty();
+    }
+
+    Function BoundCall::getFunction() const {
+        return Function(func);
+    }
+
+    const Object& BoundCall::getEnv() const {
+        return env;
+    }
+
+    std::pair<unsigned int, unsigned int> BoundCall::getNumOfParams() const {
+        return { minParams, maxParams };
+    }
+
+    void BoundCall::checkNumOfParams(std::size_t params) const {
+        if (vm == nullptr) throw RuntimeException(nullptr, "VM is not initialised");
+        if (params < minParams || params > maxParams) {
+            throw RuntimeException(nullptr, "Number of arguments does not match");
+        }
+    }
+}
@@ -0,0 +1,231 @@
+#include "simplesquirrel/buffer.hpp"
+#include "simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+#include <cstring>
+#include <typeinfo>
+
+namespace ssq {
+    namespace detail {
+        static const char* bufferDelegateKey = "ssq::Buffer";
+
+        static size_t bufferTypeTag() {
+            static const size_t hashCode = typeid(BufferView).hash_code();
+            return hashCode;
+        }
+
+        static const char* bufferTypeName(BufferType type) {
+            switch (type) {
+                case BufferType::INT8: return "int8 buffer";
+                case BufferType::UINT8: return "uint8 buffer";
+                case BufferType::INT16: return "int16 buffer";
+                case BufferType::UINT16: return "uint16 buffer";
+                case BufferType::INT32: return "int32 buffer";
+                case BufferType::UINT32: return "uint32 buffer";
+                case BufferType::INT64: return "int64 buffer";
+                case BufferType::UINT64: return "uint64 buffer";
+                case BufferType::FLOAT: return "float buffer";
+                case BufferType::DOUBLE: return "double buffer";
+            }
+            return "buffer";
+        }
+
+        template<typename T>
+        static void setElement(const BufferView& view, size_t index, T value) {
+            switch (view.type) {
+                case BufferType::INT8: static_cast<int8_t*>(view.data)[index] = static_cast<int8_t>(value); break;
+                case BufferType::UINT8: static_cast<uint8_t*>(view.data)[index] = static_cast<uint8_t>(value); break;
+                case BufferType::INT16: static_cast<int16_t*>(view.data)[index] = static_cast<int16_t>(value); break;
+                case BufferType::UINT16: static_cast<uint16_t*>(view.data)[index] = static_cast<uint16_t>(value); break;
+                case BufferType::INT32: static_cast<int32_t*>(view.data)[index] = static_cast<int32_t>(value); break;
+                case BufferType::UINT32: static_cast<uint32_t*>(view.data)[index] = static_cast<uint32_t>(value); break;
+                case BufferType::INT64: static_cast<int64_t*>(view.data)[index] = static_cast<int64_t>(value); break;
+                case BufferType::UINT64: static_cast<uint64_t*>(view.data)[index] = static_cast<uint64_t>(value); break;
+                case BufferType::FLOAT: static_cast<float*>(view.data)[index] = static_cast<float>(value); break;
+                case BufferType::DOUBLE: static_cast<double*>(view.data)[index] = static_cast<double>(value); break;
+            }
+        }
+
+        static void pushElement(HSQUIRRELVM vm, const BufferView& view, size_t index) {
+            switch (view.type) {
+                case BufferType::INT8: sq_pushinteger(vm, static_cast<const int8_t*>(view.data)[index]); break;
+                case BufferType::UINT8: sq_pushinteger(vm, static_cast<const uint8_t*>(view.data)[index]); break;
+                case BufferType::INT16: sq_pushinteger(vm, static_cast<const int16_t*>(view.data)[index]); break;
+                case BufferType::UINT16: sq_pushinteger(vm, static_cast<const uint16_t*>(view.data)[index]); break;
+                case BufferType::INT32: sq_pushinteger(vm, static_cast<const int32_t*>(view.data)[index]); break;
+                case BufferType::UINT32: sq_pushinteger(vm, static_cast<SQInteger>(static_cast<const uint32_t*>(view.data)[index])); break;
+                case BufferType::INT64: sq_pushinteger(vm, static_cast<SQInteger>(static_cast<const int64_t*>(view.data)[index])); break;
+                case BufferType::UINT64: sq_pushinteger(vm, static_cast<SQInteger>(static_cast<const uint64_t*>(view.data)[index])); break;
+                case BufferType::FLOAT: sq_pushfloat(vm, static_cast<SQFloat>(static_cast<const float*>(view.data)[index])); break;
+                case BufferType::DOUBLE: sq_pushfloat(vm, static_cast<SQFloat>(static_cast<const double*>(view.data)[index])); break;
+            }
+        }
+
+        static BufferView* getSelf(HSQUIRRELVM vm) {
+            SQUserPointer ptr = nullptr;
+            SQUserPointer typetag = nullptr;
+            if (SQ_FAILED(sq_getuserdata(vm, 1, &ptr, &typetag)) || reinterpret_cast<size_t>(typetag) != bufferTypeTag()) {
+                return nullptr;
+            }
+            return static_cast<BufferView*>(ptr);
+        }
+
+        // Returns the index at the stack position, or -1 after raising the error
+        static SQInteger getIndex(HSQUIRRELVM vm, const BufferView& view) {
+            if (sq_gettype(vm, 2) != OT_INTEGER) {
+                // A null error means the key was not found, rather than a failure
+                sq_pushnull(vm);
+                sq_throwobject(vm);
+                return -1;
+            }
+            SQInteger index;
+            sq_getinteger(vm, 2, &index);
+            if (index < 0 || static_cast<size_t>(index) >= view.size) {
+                sq_throwerror(vm, "index out of range");
+                return -1;
+            }
+            return index;
+        }
+
+        static SQInteger getFunc(HSQUIRRELVM vm) {
+            BufferView* self = getSelf(vm);
+            if (self == nullptr) {
+                return sq_throwerror(vm, "not a buffer");
+            }
+            const SQInteger index = getIndex(vm, *self);
+            if (index < 0) {
+                return SQ_ERROR;
+            }
+            pushElement(vm, *self, static_cast<size_t>(index));
+            return 1;
+        }
+
+        static SQInteger setFunc(HSQUIRRELVM vm) {
+            BufferView* self = getSelf(vm);
+            if (self == nullptr) {
+                return sq_throwerror(vm, "not a buffer");
+            }
+            if (self->readOnly) {
+                return sq_throwerror(vm, "buffer is read-only");
+            }
+            const SQInteger index = getIndex(vm, *self);
+            if (index < 0) {
+                return SQ_ERROR;
+            }
+
+            if (self->type == BufferType::FLOAT || self->type == BufferType::DOUBLE) {
+                SQFloat value;
+                if (SQ_FAILED(sq_getfloat(vm, 3, &value))) {
+                    return sq_throwerror(vm, "buffer elements must be numbers");
+                }
+                setElement(*self, static_cast<size_t>(index), value);
+            } else {
+                SQInteger value;
+                if (SQ_FAILED(sq_getinteger(vm, 3, &value))) {
+                    return sq_throwerror(vm, "buffer elements must be numbers");
+                }
+                setElement(*self, static_cast<size_t>(index), value);
+            }
+            return 0;
+        }
+
+        static SQInteger nextiFunc(HSQUIRRELVM vm) {
+            BufferView* self = getSelf(vm);
+            if (self == nullptr) {
+                return sq_throwerror(vm, "not a buffer");
+            }
+            SQInteger next = 0;
+            if (sq_gettype(vm, 2) == OT_INTEGER) {
+                sq_getinteger(vm, 2, &next);
+                next++;
+            }
+            if (next < 0 || static_cast<size_t>(next) >= self->size) {
+                sq_pushnull(vm);
+            } else {
+                sq_pushinteger(vm, next);
+            }
+            return 1;
+        }
+
+        static SQInteger lenFunc(HSQUIRRELVM vm) {
+            BufferView* self = getSelf(vm);
+            if (self == nullptr) {
+                return sq_throwerror(vm, "not a buffer");
+            }
+            sq_pushinteger(vm, static_cast<SQInteger>(self->size));
+            return 1;
+        }
+
+        void registerBufferLib(HSQUIRRELVM vm) {
+            if (findClassObj<BufferView>(vm) != nullptr) {
+                return;
+            }
+
+            static const struct {
+                const char* name;
+                SQFUNCTION func;
+                SQInteger nparams;
+                const char* typemask;
+            } funcs[] = {
+                { "_get", &getFunc, 2, "u." },
+                { "_set", &setFunc, 3, "u.." },
+                { "_nexti", &nextiFunc, 2, "u." },
+                { "len", &lenFunc, 1, "u" }
+            };
+
+            // The delegate is owned by the registry table, the class registry only finds it quickly
+            sq_pushregistrytable(vm);
+            sq_pushstring(vm, bufferDelegateKey, strlen(bufferDelegateKey));
+            sq_newtable(vm);
+            for (const auto& f : funcs) {
+                sq_pushstring(vm, f.name, strlen(f.name));
+                sq_newclosure(vm, f.func, 0);
+                sq_setparamscheck(vm, f.nparams, f.nparams, f.typemask);
+                sq_setnativeclosurename(vm, -1, f.name);
+                sq_newslot(vm, -3, SQFalse);
+            }
+
+            HSQOBJECT delegate;
+            sq_getstackobj(vm, -1, &delegate);
+            if (SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                sq_pop(vm, 1);
+                throw RuntimeException(vm, "Failed to register the buffer delegate!");
+            }
+            sq_pop(vm, 1);
+
+            addClassObj(vm, typeid(BufferView*).hash_code(), delegate);
+        }
+
+        void pushBuffer(HSQUIRRELVM vm, const BufferView& view) {
+            const HSQOBJECT* delegate = findClassObj<BufferView>(vm);
+            if (delegate == nullptr) {
+                registerBufferLib(vm);
+                delegate = findClassObj<BufferView>(vm);
+            }
+
+            BufferView* data = static_cast<BufferView*>(sq_newuserdata(vm, sizeof(BufferView)));
+            *data = view;
+            sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(bufferTypeTag()));
+            sq_pushobject(vm, *delegate);
+            sq_setdelegate(vm, -2);
+        }
+
+        BufferView getBuffer(HSQUIRRELVM vm, SQInteger index, BufferType type, bool writable) {
+            SQUserPointer ptr = nullptr;
+            SQUserPointer typetag = nullptr;
+            const SQObjectType actual = sq_gettype(vm, index);
+            if (actual != OT_USERDATA || SQ_FAILED(sq_getuserdata(vm, index, &ptr, &typetag)) ||
+                reinterpret_cast<size_t>(typetag) != bufferTypeTag()) {
+                throw TypeException("bad cast", bufferTypeName(type), typeToStr(Type(actual)));
+            }
+
+            const BufferView& view = *static_cast<const BufferView*>(ptr);
+            if (view.type != type) {
+                throw TypeException("bad cast", bufferTypeName(type), bufferTypeName(view.type));
+            }
+            if (writable && view.readOnly) {
+                throw TypeException("bad cast", "writable buffer", "read-only buffer");
+            }
+            return view;
+        }
+    }
+}
@@ -2,10 +2,38 @@
 #include "simplesquirrel/class.hpp"
 #include "simplesquirrel/exceptions.hpp"
 #include "simplesquirrel/function.hpp"
+#include "simplesquirrel/interrupt.hpp"
 #include <squirrel.h>
 #include <forward_list>
 
 namespace ssq {
+    // Calls a member variable accessor stored in the "_get" or "_set" table, if there is one on top of the stack
+    static bool callVarAccessor(HSQUIRRELVM vm, SQInteger& result) {
+        if (sq_gettype(vm, -1) != OT_USERDATA) {
+            return false;
+        }
+        SQUserPointer data = nullptr;
+        SQUserPointer typetag = nullptr;
+        if (SQ_FAILED(sq_getuserdata(vm, -1, &data, &typetag)) || typetag != detail::varAccessorTypeTag()) {
+            return false;
+        }
+
+        SQUserPointer self = nullptr;
+        if (SQ_FAILED(sq_getinstanceup(vm, 1, &self, nullptr, SQTrue)) || self == nullptr) {
+            result = sq_throwerror(vm, "Member variable accessed on an uninitialised instance!");
+            return true;
+        }
+
+        detail::VarAccessorFunc func = *reinterpret_cast<detail::VarAccessorFunc*>(data);
+        try {
+            detail::checkInterrupt(vm);
+            result = func(vm, self, data);
+        } catch (const std::exception& e) {
+            result = sq_throwerror(vm, e.what());
+        }
+        return true;
+    }
+
 	Class::Class() :Object(), tableSet(), tableGet() {
 
     }
@@ -60,15 +88,17 @@ namespace ssq {
         return *this;
     }
 
-    void Class::findTable(const char* name, Object& table, SQFUNCTION dlg) const {
+    void Class::findTable(const Key& key, Object& table, SQFUNCTION dlg) const {
         // Check if the table has been referenced
         if(!table.isEmpty()) {
             return;
         }
-            
+
+        detail::ObjectAllocatorScope scope(vm);
+
         // Find the table
         sq_pushobject(vm, obj);
-        sq_pushstring(vm, name, strlen(name));
+        sq_pushobject(vm, key.getRaw());
 
         if (SQ_FAILED(sq_get(vm, -2))) {
             // Does not exist
@@ -90,12 +120,12 @@ namespace ssq {
             sq_pop(vm, 1); // Pop table
 
             sq_pushobject(vm, obj); // Push class obj
-            sq_pushstring(vm, name, strlen(name));
+            sq_pushobject(vm, key.getRaw());
             sq_pushobject(vm, table.getRaw());
             sq_newclosure(vm, dlg, 1);
 
             if(SQ_FAILED(sq_newslot(vm, -3, false))) {
-                throw RuntimeException(vm, "Failed to create table '" + std::string(name) + "'!");
+                throw RuntimeException(vm, "Failed to create table '" + key.getName() + "'!");
             }
 
             sq_pop(vm, 1); // Pop class obj
@@ -124,6 +154,12 @@ namespace ssq {
             return sq_throwerror(vm, ("Variable not found: " + detail::pop<std::string>(vm, 2)).c_str());
         }
 
+        // Plain member variables are read directly, without calling into the VM
+        SQInteger result;
+        if (callVarAccessor(vm, result)) {
+            return result;
+        }
+
         // Push 'this'
         sq_push(vm, 1);
 
@@ -149,6 +185,12 @@ namespace ssq {
             return sq_throwerror(vm, ("Variable not found: " + detail::pop<std::string>(vm, 2)).c_str());
         }
 
+        // Plain member variables are written directly, without calling into the VM
+        SQInteger result;
+        if (callVarAccessor(vm, result)) {
+            return result;
+        }
+
         // Push 'this'
         sq_push(vm, 1);
 
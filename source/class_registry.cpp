@@ -0,0 +1,111 @@
+#include "simplesquirrel/class_registry.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace ssq {
+    namespace detail {
+        static const size_t initialCapacity = 16;
+        static std::atomic<uint64_t> nextGeneration(1);
+
+        ClassRegistry::ClassRegistry():count(0), generation(nextGeneration++) {
+
+        }
+
+        size_t ClassRegistry::slotIndex(size_t hashCode) const {
+            // typeid hash codes are often aligned pointers, spread the low bits
+            size_t h = hashCode;
+            h ^= h >> 16;
+            h *= static_cast<size_t>(0x9E3779B97F4A7C15ULL);
+            h ^= h >> 16;
+            return h & (slots.size() - 1);
+        }
+
+        void ClassRegistry::rehash(size_t capacity) {
+            std::vector<Slot> old;
+            old.swap(slots);
+
+            Slot empty;
+            empty.hashCode = 0;
+            sq_resetobject(&empty.obj);
+            slots.assign(capacity, empty);
+
+            for (const Slot& slot : old) {
+                if (slot.obj._type == OT_NULL) continue;
+                size_t i = slotIndex(slot.hashCode);
+                while (slots[i].obj._type != OT_NULL) {
+                    i = (i + 1) & (capacity - 1);
+                }
+                slots[i] = slot;
+            }
+        }
+
+        void ClassRegistry::insert(size_t hashCode, const HSQOBJECT& obj) {
+            generation = nextGeneration++;
+            if (slots.empty()) {
+                rehash(initialCapacity);
+            } else if ((count + 1) * 2 > slots.size()) {
+                rehash(slots.size() * 2);
+            }
+
+            size_t i = slotIndex(hashCode);
+            while (slots[i].obj._type != OT_NULL) {
+                if (slots[i].hashCode == hashCode) {
+                    slots[i].obj = obj;
+                    return;
+                }
+                i = (i + 1) & (slots.size() - 1);
+            }
+
+            slots[i].hashCode = hashCode;
+            slots[i].obj = obj;
+            count++;
+        }
+
+        const HSQOBJECT* ClassRegistry::find(size_t hashCode) const {
+            if (slots.empty()) return nullptr;
+
+            size_t i = slotIndex(hashCode);
+            while (slots[i].obj._type != OT_NULL) {
+                if (slots[i].hashCode == hashCode) {
+                    return &slots[i].obj;
+                }
+                i = (i + 1) & (slots.size() - 1);
+            }
+            return nullptr;
+        }
+
+        void ClassRegistry::clear() {
+            slots.clear();
+            count = 0;
+            generation = nextGeneration++;
+        }
+
+        size_t ClassRegistry::size() const {
+            return count;
+        }
+
+        void ClassRegistry::swap(ClassRegistry& other) NOEXCEPT {
+            using std::swap;
+            swap(slots, other.slots);
+            swap(count, other.count);
+            swap(generation, other.generation);
+        }
+
+        static std::mutex copiersMutex;
+        static std::unordered_map<size_t, ClassCopier> copiers;
+
+        void addClassCopier(size_t hashCode, const ClassCopier& copier) {
+            std::lock_guard<std::mutex> lock(copiersMutex);
+            copiers[hashCode] = copier;
+        }
+
+        const ClassCopier* findClassCopier(size_t hashCode) {
+            std::lock_guard<std::mutex> lock(copiersMutex);
+            auto it = copiers.find(hashCode);
+            // Map nodes never move, the copier stays valid
+            return it != copiers.end() ? &it->second : nullptr;
+        }
+    }
+}
@@ -12,6 +12,7 @@ namespace ssq {
     }
 
     Enum::Enum(HSQUIRRELVM vm):Object(vm) {
+        detail::ObjectAllocatorScope scope(vm);
         sq_newtable(vm);
         sq_getstackobj(vm, -1, &obj);
         sq_addref(vm, &obj);
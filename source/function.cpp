@@ -33,6 +33,15 @@ namespace ssq {
         return { nparamsmin - 1, nparamsmax - 1 };
     }
 
+    namespace detail {
+        void callPushed(HSQUIRRELVM vm, SQUnsignedInteger nparams, bool retval, SQInteger top) {
+            if (SQ_FAILED(sq_call(vm, 1 + nparams, retval ? SQTrue : SQFalse, SQTrue))) {
+                sq_settop(vm, top);
+                throw RuntimeException(vm, "Error running script!");
+            }
+        }
+    }
+
     Function& Function::operator = (const Function& other){
         Object::operator = (other);
         return *this;
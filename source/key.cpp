@@ -0,0 +1,51 @@
+#include "simplesquirrel/object.hpp"
+#include "simplesquirrel/key.hpp"
+#include <squirrel.h>
+#include <cstring>
+
+namespace ssq {
+    Key::Key():Object() {
+
+    }
+
+    Key::Key(HSQUIRRELVM vm, const char* name):Object(vm), name(name) {
+        detail::ObjectAllocatorScope scope(vm);
+        sq_pushstring(vm, name, static_cast<SQInteger>(strlen(name)));
+        sq_getstackobj(vm, -1, &obj);
+        sq_addref(vm, &obj);
+        sq_pop(vm, 1);
+    }
+
+    Key::Key(const Key& other):Object(other), name(other.name) {
+
+    }
+
+    Key::Key(Key&& other) NOEXCEPT :Object(std::forward<Object>(other)), name(std::move(other.name)) {
+
+    }
+
+    void Key::swap(Key& other) NOEXCEPT {
+        using std::swap;
+        Object::swap(other);
+        swap(name, other.name);
+    }
+
+    const std::string& Key::getName() const {
+        return name;
+    }
+
+    Key& Key::operator = (const Key& other) {
+        if (this != &other) {
+            Key o(other);
+            swap(o);
+        }
+        return *this;
+    }
+
+    Key& Key::operator = (Key&& other) NOEXCEPT {
+        if (this != &other) {
+            swap(other);
+        }
+        return *this;
+    }
+}
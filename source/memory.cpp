@@ -0,0 +1,379 @@
+#include "simplesquirrel/memory.hpp"
+#include <squirrel.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace ssq {
+    static constexpr size_t memoryAlignment = alignof(std::max_align_t);
+
+    static constexpr size_t alignSize(size_t size) {
+        return size == 0 ? memoryAlignment : (size + memoryAlignment - 1) & ~(memoryAlignment - 1);
+    }
+
+    void* Allocator::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        void* result = allocate(newSize);
+        if (result != nullptr && ptr != nullptr) {
+            memcpy(result, ptr, std::min(oldSize, newSize));
+            deallocate(ptr, oldSize);
+        }
+        return result;
+    }
+
+    void* MallocAllocator::allocate(size_t size) {
+        return malloc(size);
+    }
+
+    void MallocAllocator::deallocate(void* ptr, size_t size) {
+        free(ptr);
+    }
+
+    void* MallocAllocator::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        return realloc(ptr, newSize);
+    }
+
+    struct ArenaAllocator::Chunk {
+        Chunk* next;
+        size_t size;
+        size_t used;
+
+        char* data() {
+            return reinterpret_cast<char*>(this) + alignSize(sizeof(Chunk));
+        }
+    };
+
+    ArenaAllocator::ArenaAllocator(size_t chunkSize):head(nullptr), chunkSize(alignSize(chunkSize)), reserved(0), lastBlock(nullptr) {
+
+    }
+
+    ArenaAllocator::~ArenaAllocator() {
+        release();
+    }
+
+    void* ArenaAllocator::allocate(size_t size) {
+        size = alignSize(size);
+
+        if (head == nullptr || size > chunkSize / 2 || head->used + size > head->size) {
+            const size_t capacity = std::max(size, chunkSize);
+            Chunk* chunk = reinterpret_cast<Chunk*>(malloc(alignSize(sizeof(Chunk)) + capacity));
+            if (chunk == nullptr) {
+                return nullptr;
+            }
+            chunk->size = capacity;
+            chunk->used = size;
+            reserved += capacity;
+
+            if (head != nullptr && size > chunkSize / 2) {
+                // A block of its own, keep bumping in the current chunk
+                chunk->next = head->next;
+                head->next = chunk;
+                return chunk->data();
+            }
+
+            chunk->next = head;
+            head = chunk;
+            lastBlock = chunk->data();
+            return lastBlock;
+        }
+
+        lastBlock = head->data() + head->used;
+        head->used += size;
+        return lastBlock;
+    }
+
+    void ArenaAllocator::deallocate(void* ptr, size_t size) {
+        // Only the most recent block can be given back
+        if (ptr != nullptr && ptr == lastBlock) {
+            head->used = static_cast<size_t>(lastBlock - head->data());
+            lastBlock = nullptr;
+        }
+    }
+
+    void* ArenaAllocator::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        if (ptr == nullptr) {
+            return allocate(newSize);
+        }
+
+        if (ptr == lastBlock) {
+            // Grow or shrink the most recent block in place
+            const size_t offset = static_cast<size_t>(lastBlock - head->data());
+            if (offset + alignSize(newSize) <= head->size) {
+                head->used = offset + alignSize(newSize);
+                return ptr;
+            }
+        } else if (alignSize(newSize) <= alignSize(oldSize)) {
+            return ptr;
+        }
+
+        void* result = allocate(newSize);
+        if (result != nullptr) {
+            memcpy(result, ptr, std::min(oldSize, newSize));
+            deallocate(ptr, oldSize);
+        }
+        return result;
+    }
+
+    void ArenaAllocator::release() {
+        while (head != nullptr) {
+            Chunk* next = head->next;
+            free(head);
+            head = next;
+        }
+        reserved = 0;
+        lastBlock = nullptr;
+    }
+
+    size_t ArenaAllocator::getReserved() const {
+        return reserved;
+    }
+
+    static const size_t poolClassSizes[] = {
+        16, 32, 48, 64, 80, 96, 112, 128,
+        160, 192, 224, 256,
+        320, 384, 448, 512,
+        640, 768, 896, 1024
+    };
+
+    // Returns the index of the smallest size class that fits
+    static size_t poolClassIndex(size_t size) {
+        if (size <= 128) {
+            return size == 0 ? 0 : (size - 1) / 16;
+        } else if (size <= 256) {
+            return 8 + (size - 129) / 32;
+        } else if (size <= 512) {
+            return 12 + (size - 257) / 64;
+        }
+        return 16 + (size - 513) / 128;
+    }
+
+    PoolAllocator::PoolAllocator(size_t chunkSize):arena(chunkSize) {
+        static_assert(sizeof(poolClassSizes) / sizeof(poolClassSizes[0]) == numClasses, "Size class count mismatch");
+        std::fill(freeLists, freeLists + numClasses, nullptr);
+    }
+
+    void* PoolAllocator::allocate(size_t size) {
+        if (size > maxBlockSize) {
+            return malloc(size);
+        }
+
+        const size_t cls = poolClassIndex(size);
+        void* block = freeLists[cls];
+        if (block != nullptr) {
+            freeLists[cls] = *reinterpret_cast<void**>(block);
+            return block;
+        }
+        return arena.allocate(poolClassSizes[cls]);
+    }
+
+    void PoolAllocator::deallocate(void* ptr, size_t size) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (size > maxBlockSize) {
+            free(ptr);
+            return;
+        }
+
+        const size_t cls = poolClassIndex(size);
+        *reinterpret_cast<void**>(ptr) = freeLists[cls];
+        freeLists[cls] = ptr;
+    }
+
+    void* PoolAllocator::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        if (ptr == nullptr) {
+            return allocate(newSize);
+        }
+        if (oldSize > maxBlockSize && newSize > maxBlockSize) {
+            return realloc(ptr, newSize);
+        }
+        if (oldSize <= maxBlockSize && newSize <= maxBlockSize && poolClassIndex(oldSize) == poolClassIndex(newSize)) {
+            return ptr;
+        }
+
+        void* result = allocate(newSize);
+        if (result != nullptr) {
+            memcpy(result, ptr, std::min(oldSize, newSize));
+            deallocate(ptr, oldSize);
+        }
+        return result;
+    }
+
+    static thread_local Allocator* currentAllocator = nullptr;
+
+    AllocatorScope::AllocatorScope(Allocator* allocator):previous(currentAllocator) {
+        currentAllocator = allocator;
+    }
+
+    AllocatorScope::AllocatorScope(HSQUIRRELVM vm):previous(currentAllocator) {
+        currentAllocator = vm != nullptr ? detail::getAllocator(vm) : nullptr;
+    }
+
+    AllocatorScope::AllocatorScope(std::nullptr_t):previous(currentAllocator) {
+        currentAllocator = nullptr;
+    }
+
+    AllocatorScope::~AllocatorScope() {
+        currentAllocator = previous;
+    }
+
+    namespace detail {
+        struct BlockHeader {
+            Allocator* allocator;
+            size_t size;
+        };
+
+        static constexpr size_t blockHeaderSize = alignSize(sizeof(BlockHeader));
+
+        static BlockHeader* getBlockHeader(void* ptr) {
+            return reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - blockHeaderSize);
+        }
+
+        AccountingAllocator::AccountingAllocator(std::shared_ptr<Allocator> allocator):allocator(std::move(allocator)), released(false),
+            stats(), overLimit(false), collectInterval(0), nextCollect(SIZE_MAX), collectRequested(false) {
+
+        }
+
+        void AccountingAllocator::release(AccountingAllocator* accounting) {
+            if (accounting == nullptr) {
+                return;
+            }
+            // Blocks are only left when an object of another VM was created
+            // from this allocator, it must outlive them
+            accounting->released = true;
+            accounting->setLimit(0);
+            accounting->setCollectInterval(0);
+            accounting->resetCollect();
+            if (accounting->stats.current == 0) {
+                delete accounting;
+            }
+        }
+
+        void* AccountingAllocator::allocate(size_t size) {
+            void* ptr = allocator != nullptr ? allocator->allocate(size) : malloc(size);
+            if (ptr != nullptr) {
+                stats.allocations++;
+                stats.current += size;
+                stats.peak = std::max(stats.peak, stats.current);
+                updateLimit();
+                if (stats.allocations >= nextCollect) {
+                    // Collecting in the middle of an allocation is not safe, wait for a safe point
+                    collectRequested = true;
+                }
+            }
+            return ptr;
+        }
+
+        void AccountingAllocator::deallocate(void* ptr, size_t size) {
+            if (allocator != nullptr) {
+                allocator->deallocate(ptr, size);
+            } else {
+                free(ptr);
+            }
+            stats.current -= size;
+            updateLimit();
+            if (released && stats.current == 0) {
+                delete this;
+            }
+        }
+
+        void* AccountingAllocator::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+            void* result = allocator != nullptr ? allocator->reallocate(ptr, oldSize, newSize) : realloc(ptr, newSize);
+            if (result != nullptr) {
+                stats.current = stats.current - oldSize + newSize;
+                stats.peak = std::max(stats.peak, stats.current);
+                updateLimit();
+            }
+            return result;
+        }
+
+        void AccountingAllocator::setLimit(size_t limit) {
+            stats.limit = limit;
+            updateLimit();
+        }
+
+        void AccountingAllocator::setCollectInterval(size_t allocations) {
+            collectInterval = allocations;
+            nextCollect = allocations != 0 ? stats.allocations + allocations : SIZE_MAX;
+        }
+
+        void AccountingAllocator::resetCollect() {
+            collectRequested = false;
+            nextCollect = collectInterval != 0 ? stats.allocations + collectInterval : SIZE_MAX;
+        }
+
+        void AccountingAllocator::updateLimit() {
+            // Squirrel cannot handle failed allocations, going over the limit
+            // stops the script at the next safe point instead
+            overLimit = stats.limit != 0 && stats.current > stats.limit;
+        }
+
+        Allocator* getCurrentAllocator() {
+            return currentAllocator;
+        }
+
+        void setCurrentAllocator(Allocator* allocator) {
+            currentAllocator = allocator;
+        }
+
+        void* allocate(Allocator* allocator, size_t size) {
+            const size_t total = blockHeaderSize + size;
+            void* base = allocator != nullptr ? allocator->allocate(total) : malloc(total);
+            if (base == nullptr) {
+                return nullptr;
+            }
+
+            BlockHeader* header = reinterpret_cast<BlockHeader*>(base);
+            header->allocator = allocator;
+            header->size = size;
+            return static_cast<char*>(base) + blockHeaderSize;
+        }
+
+        void* reallocate(void* ptr, size_t size) {
+            if (ptr == nullptr) {
+                return allocate(currentAllocator, size);
+            }
+
+            // The block stays with the allocator it came from
+            BlockHeader* header = getBlockHeader(ptr);
+            Allocator* allocator = header->allocator;
+            const size_t total = blockHeaderSize + size;
+            void* base = allocator != nullptr ?
+                allocator->reallocate(header, blockHeaderSize + header->size, total) : realloc(header, total);
+            if (base == nullptr) {
+                return nullptr;
+            }
+
+            header = reinterpret_cast<BlockHeader*>(base);
+            header->size = size;
+            return static_cast<char*>(base) + blockHeaderSize;
+        }
+
+        void deallocate(void* ptr) {
+            if (ptr == nullptr) {
+                return;
+            }
+
+            BlockHeader* header = getBlockHeader(ptr);
+            if (header->allocator != nullptr) {
+                header->allocator->deallocate(header, blockHeaderSize + header->size);
+            } else {
+                free(header);
+            }
+        }
+    }
+}
+
+#ifdef SSQ_CUSTOM_ALLOCATORS
+// Replace the memory functions of Squirrel, which must be built with SQ_EXCLUDE_DEFAULT_MEMFUNCTIONS
+void* sq_vm_malloc(SQUnsignedInteger size) {
+    return ssq::detail::allocate(ssq::detail::getCurrentAllocator(), static_cast<size_t>(size));
+}
+
+void* sq_vm_realloc(void* p, SQUnsignedInteger oldsize, SQUnsignedInteger size) {
+    return ssq::detail::reallocate(p, static_cast<size_t>(size));
+}
+
+void sq_vm_free(void* p, SQUnsignedInteger size) {
+    ssq::detail::deallocate(p);
+}
+#endif
@@ -0,0 +1,282 @@
+#include "simplesquirrel/message.hpp"
+#include "simplesquirrel/vm.hpp"
+#include "simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace ssq {
+    namespace detail {
+        struct MessageData {
+            // Values in pre-order, a table is followed by its keys and values, an array by its elements
+            struct Node {
+                SQObjectType type;
+                // Number of slots of a table, elements of an array, or length of a string
+                uint32_t size;
+                union {
+                    SQInteger integer;
+                    SQFloat real;
+                    SQBool boolean;
+                    // Offset of a string, or index of an instance
+                    size_t offset;
+                };
+            };
+
+            struct Copy {
+                const ClassCopier* copier;
+                void* ptr;
+            };
+
+            std::vector<Node> nodes;
+            std::string strings;
+            std::vector<Copy> copies;
+
+            MessageData() = default;
+            MessageData(const MessageData& other) = delete;
+            MessageData& operator = (const MessageData& other) = delete;
+
+            ~MessageData() {
+                for (const Copy& copy : copies) {
+                    copy.copier->destroy(copy.ptr);
+                }
+            }
+        };
+
+        class MessageWriter {
+        public:
+            MessageWriter(HSQUIRRELVM vm, MessageData& data):vm(vm), data(data) {
+            }
+
+            void write(SQInteger index) {
+                if (index < 0) {
+                    index = sq_gettop(vm) + index + 1;
+                }
+
+                MessageData::Node node;
+                node.type = sq_gettype(vm, index);
+                node.size = 0;
+                node.integer = 0;
+
+                switch (node.type) {
+                    case OT_NULL:
+                        break;
+                    case OT_INTEGER:
+                        sq_getinteger(vm, index, &node.integer);
+                        break;
+                    case OT_FLOAT:
+                        sq_getfloat(vm, index, &node.real);
+                        break;
+                    case OT_BOOL:
+                        sq_getbool(vm, index, &node.boolean);
+                        break;
+                    case OT_STRING: {
+                        const SQChar* str = nullptr;
+                        SQInteger length = 0;
+                        sq_getstringandsize(vm, index, &str, &length);
+                        node.offset = data.strings.size();
+                        node.size = static_cast<uint32_t>(length);
+                        data.strings.append(str, static_cast<size_t>(length));
+                        break;
+                    }
+                    case OT_TABLE:
+                    case OT_ARRAY:
+                        writeContainer(index, node);
+                        return;
+                    case OT_INSTANCE:
+                        writeInstance(index, node);
+                        break;
+                    default:
+                        throw TypeException("value cannot be captured in a message", "TABLE, ARRAY or a plain value",
+                            typeToStr(Type(node.type)));
+                }
+
+                data.nodes.push_back(node);
+            }
+
+        private:
+            void writeContainer(SQInteger index, MessageData::Node& node) {
+                HSQOBJECT obj;
+                sq_getstackobj(vm, index, &obj);
+                const void* ptr = obj._unVal.pRefCounted;
+                if (std::find(path.begin(), path.end(), ptr) != path.end()) {
+                    throw TypeException("cyclic reference cannot be captured in a message", "acyclic value",
+                        typeToStr(Type(node.type)));
+                }
+                path.push_back(ptr);
+
+                const size_t position = data.nodes.size();
+                data.nodes.push_back(node);
+
+                uint32_t count = 0;
+                sq_pushnull(vm);
+                while (SQ_SUCCEEDED(sq_next(vm, index))) {
+                    if (node.type == OT_TABLE) {
+                        write(-2);
+                    }
+                    write(-1);
+                    sq_pop(vm, 2);
+                    count++;
+                }
+                sq_pop(vm, 1);
+
+                data.nodes[position].size = count;
+                path.pop_back();
+            }
+
+            void writeInstance(SQInteger index, MessageData::Node& node) {
+                SQUserPointer typetag = nullptr;
+                SQUserPointer up = nullptr;
+                sq_gettypetag(vm, index, &typetag);
+                const ClassCopier* copier = findClassCopier(reinterpret_cast<size_t>(typetag));
+                if (copier == nullptr || SQ_FAILED(sq_getinstanceup(vm, index, &up, nullptr, SQFalse)) || up == nullptr) {
+                    throw TypeException("instance cannot be captured in a message", "instance of a copyable exposed class",
+                        "other instance");
+                }
+
+                MessageData::Copy copy = { copier, nullptr };
+                copy.ptr = copier->copy(up);
+                node.offset = data.copies.size();
+                data.copies.push_back(copy);
+            }
+
+            HSQUIRRELVM vm;
+            MessageData& data;
+            // Containers being written, to detect cycles
+            std::vector<const void*> path;
+        };
+
+        class MessageReader {
+        public:
+            MessageReader(HSQUIRRELVM vm, const MessageData& data):vm(vm), data(data), position(0) {
+            }
+
+            void read() {
+                const MessageData::Node& node = data.nodes[position++];
+                switch (node.type) {
+                    case OT_INTEGER:
+                        sq_pushinteger(vm, node.integer);
+                        break;
+                    case OT_FLOAT:
+                        sq_pushfloat(vm, node.real);
+                        break;
+                    case OT_BOOL:
+                        sq_pushbool(vm, node.boolean);
+                        break;
+                    case OT_STRING:
+                        sq_pushstring(vm, data.strings.data() + node.offset, node.size);
+                        break;
+                    case OT_TABLE:
+                        sq_newtableex(vm, node.size);
+                        for (uint32_t i = 0; i < node.size; i++) {
+                            read();
+                            read();
+                            sq_newslot(vm, -3, SQFalse);
+                        }
+                        break;
+                    case OT_ARRAY:
+                        sq_newarray(vm, 0);
+                        for (uint32_t i = 0; i < node.size; i++) {
+                            read();
+                            sq_arrayappend(vm, -2);
+                        }
+                        break;
+                    case OT_INSTANCE: {
+                        const MessageData::Copy& copy = data.copies[node.offset];
+                        copy.copier->push(vm, copy.ptr);
+                        break;
+                    }
+                    default:
+                        sq_pushnull(vm);
+                        break;
+                }
+            }
+
+        private:
+            HSQUIRRELVM vm;
+            const MessageData& data;
+            size_t position;
+        };
+
+        Message captureMessage(HSQUIRRELVM vm, SQInteger index) {
+            std::shared_ptr<MessageData> data = std::make_shared<MessageData>();
+            const SQInteger top = sq_gettop(vm);
+            try {
+                MessageWriter writer(vm, *data);
+                writer.write(index);
+            } catch (...) {
+                sq_settop(vm, top);
+                throw;
+            }
+
+            Message message;
+            message.data = std::move(data);
+            return message;
+        }
+
+        void pushMessage(HSQUIRRELVM vm, const Message& message) {
+            if (!message.data) {
+                sq_pushnull(vm);
+                return;
+            }
+            // A copier may throw with the containers being built still on the stack
+            const SQInteger top = sq_gettop(vm);
+            try {
+                MessageReader reader(vm, *message.data);
+                reader.read();
+            } catch (...) {
+                sq_settop(vm, top);
+                throw;
+            }
+        }
+    }
+
+    Message::Message() {
+
+    }
+
+    Message::Message(const Object& object) {
+        HSQUIRRELVM vm = object.getHandle();
+        if (vm == nullptr) {
+            return;
+        }
+
+        sq_pushobject(vm, object.getRaw());
+        try {
+            *this = detail::captureMessage(vm, -1);
+        } catch (...) {
+            sq_pop(vm, 1);
+            throw;
+        }
+        sq_pop(vm, 1);
+    }
+
+    Object Message::materialize(VM& vm) const {
+        HSQUIRRELVM handle = vm.getHandle();
+        AllocatorScope scope(handle);
+        detail::pushMessage(handle, *this);
+        try {
+            Object result = detail::popValue<Object>(handle, -1);
+            sq_pop(handle, 1);
+            return result;
+        } catch (...) {
+            sq_pop(handle, 1);
+            throw;
+        }
+    }
+
+    bool Message::isEmpty() const {
+        return getType() == Type::NULLPTR;
+    }
+
+    Type Message::getType() const {
+        return data ? Type(data->nodes.front().type) : Type::NULLPTR;
+    }
+
+    size_t Message::getSize() const {
+        if (!data) {
+            return 0;
+        }
+        return sizeof(detail::MessageData) + data->nodes.size() * sizeof(detail::MessageData::Node) + data->strings.size();
+    }
+}
@@ -5,6 +5,7 @@
 #include "simplesquirrel/exceptions.hpp"
 #include "simplesquirrel/table.hpp"
 #include "simplesquirrel/array.hpp"
+#include "simplesquirrel/key.hpp"
 #include <squirrel.h>
 #include <cstring>
 
@@ -110,6 +111,26 @@ namespace ssq {
         return ret;
     }
 
+    Object Object::find(const Key& key) const {
+        if (vm == nullptr) throw RuntimeException(nullptr, "VM is not initialised");
+
+        Object ret(vm);
+
+        sq_pushobject(vm, obj);
+        sq_pushobject(vm, key.getRaw());
+
+        if (SQ_FAILED(sq_get(vm, -2))) {
+            sq_pop(vm, 1);
+            throw NotFoundException(vm, key.getName());
+        }
+
+        sq_getstackobj(vm, -1, &ret.getRaw());
+        sq_addref(vm, &ret.getRaw());
+        sq_pop(vm, 2);
+
+        return ret;
+    }
+
     Type Object::getType() const {
         if (isEmpty()) return Type::NULLPTR;
 
@@ -0,0 +1,182 @@
+#include "simplesquirrel/overload.hpp"
+#include "simplesquirrel/allocators.hpp"
+#include <squirrel.h>
+#include <cstring>
+
+namespace ssq {
+    namespace detail {
+        static std::size_t rawTypeIndex(SQObjectType type) {
+            const SQUnsignedInteger raw = static_cast<SQUnsignedInteger>(type) & 0x00FFFFFF;
+            std::size_t index = 0;
+            while (index < numOfRawTypes && (raw >> index) != 1) {
+                index++;
+            }
+            return index;
+        }
+
+        static std::size_t lowestBit(uint64_t bits) {
+            std::size_t index = 0;
+            while ((bits & 1) == 0) {
+                bits >>= 1;
+                index++;
+            }
+            return index;
+        }
+
+        static uint64_t typemaskChar(char c) {
+            switch (c) {
+                case 'o': return 1ULL << rawTypeIndex(OT_NULL);
+                case 'i': return 1ULL << rawTypeIndex(OT_INTEGER);
+                case 'f': return 1ULL << rawTypeIndex(OT_FLOAT);
+                case 'n': return (1ULL << rawTypeIndex(OT_INTEGER)) | (1ULL << rawTypeIndex(OT_FLOAT));
+                case 's': return 1ULL << rawTypeIndex(OT_STRING);
+                case 't': return 1ULL << rawTypeIndex(OT_TABLE);
+                case 'a': return 1ULL << rawTypeIndex(OT_ARRAY);
+                case 'u': return 1ULL << rawTypeIndex(OT_USERDATA);
+                case 'c': return (1ULL << rawTypeIndex(OT_CLOSURE)) | (1ULL << rawTypeIndex(OT_NATIVECLOSURE));
+                case 'b': return 1ULL << rawTypeIndex(OT_BOOL);
+                case 'g': return 1ULL << rawTypeIndex(OT_GENERATOR);
+                case 'p': return 1ULL << rawTypeIndex(OT_USERPOINTER);
+                case 'v': return 1ULL << rawTypeIndex(OT_THREAD);
+                case 'x': return 1ULL << rawTypeIndex(OT_INSTANCE);
+                case 'y': return 1ULL << rawTypeIndex(OT_CLASS);
+                case 'r': return 1ULL << rawTypeIndex(OT_WEAKREF);
+                default: return ~0ULL;
+            }
+        }
+
+        // Accepted raw types of each parameter, the same typemask sq_setparamscheck takes
+        static std::vector<uint64_t> compileTypemask(const std::string& typemask) {
+            std::vector<uint64_t> masks;
+            uint64_t mask = 0;
+            for (size_t i = 0; i < typemask.size(); i++) {
+                const char c = typemask[i];
+                if (c == ' ') {
+                    continue;
+                }
+                mask |= typemaskChar(c);
+                if (i + 1 < typemask.size() && typemask[i + 1] == '|') {
+                    i++;
+                    continue;
+                }
+                masks.push_back(mask);
+                mask = 0;
+            }
+            return masks;
+        }
+
+        static SQInteger overloadSetReleaseHook(SQUserPointer p, SQInteger size) {
+            destroy(static_cast<OverloadSetPtr*>(p)->ptr);
+            return 0;
+        }
+
+        static SQInteger dispatchOverload(HSQUIRRELVM vm) {
+            OverloadSetPtr* setPtr;
+            sq_getuserdata(vm, -1, reinterpret_cast<void**>(&setPtr), nullptr);
+            sq_pop(vm, 2);
+            const OverloadSet& set = *setPtr->ptr;
+
+            // Only the passed arguments are on the stack now
+            const SQInteger top = sq_gettop(vm);
+            uint64_t candidates = static_cast<size_t>(top) < set.byArity.size() ? set.byArity[top] : 0;
+            for (SQInteger i = 1; i <= top && candidates != 0; i++) {
+                const std::size_t type = rawTypeIndex(sq_gettype(vm, i));
+                candidates &= type < numOfRawTypes ? set.byType[i - 1][type] : 0;
+            }
+
+            // Instances of different classes are one raw type, so their classes are told apart by type tags
+            for (SQInteger i = 1; i <= top && candidates != 0; i++) {
+                if (sq_gettype(vm, i) != OT_INSTANCE) {
+                    continue;
+                }
+                const std::vector<size_t>& tags = set.byClass[i - 1];
+                for (uint64_t remaining = candidates; remaining != 0; remaining &= remaining - 1) {
+                    const std::size_t index = lowestBit(remaining);
+                    SQUserPointer ptr;
+                    if (tags[index] != 0 &&
+                        SQ_FAILED(sq_getinstanceup(vm, i, &ptr, reinterpret_cast<SQUserPointer>(tags[index]), SQFalse))) {
+                        candidates &= ~(1ULL << index);
+                    }
+                }
+            }
+
+            if (candidates == 0) {
+                std::string error = "No overload of " + set.name + " takes (";
+                for (SQInteger i = 2; i <= top; i++) {
+                    error += i > 2 ? ", " : "";
+                    error += typeToStr(Type(sq_gettype(vm, i)));
+                }
+                error += ")";
+                return sq_throwerror(vm, error.c_str());
+            }
+
+            // The first overload added wins when several accept the arguments
+            const Overload& overload = set.overloads[lowestBit(candidates)];
+            for (const HSQOBJECT& freeVar : overload.freeVars) {
+                sq_pushobject(vm, freeVar);
+            }
+            return overload.func(vm);
+        }
+
+        OverloadSet& newOverloadSet(HSQUIRRELVM vm, const char* name) {
+            auto setPtr = reinterpret_cast<OverloadSetPtr*>(sq_newuserdata(vm, sizeof(OverloadSetPtr)));
+            setPtr->ptr = construct<OverloadSet>(vm);
+            setPtr->ptr->name = name;
+            sq_setreleasehook(vm, -1, &overloadSetReleaseHook);
+            sq_newarray(vm, 0);
+            return *setPtr->ptr;
+        }
+
+        void addOverload(HSQUIRRELVM vm, OverloadSet& set, const NativeBinding& binding) {
+            const uint64_t bit = 1ULL << set.overloads.size();
+
+            Overload overload;
+            overload.func = binding.func;
+            for (SQInteger i = 0; i < binding.nfreevars; i++) {
+                HSQOBJECT freeVar;
+                sq_getstackobj(vm, -1 - i, &freeVar);
+                overload.freeVars.push_back(freeVar);
+            }
+            for (SQInteger remaining = binding.nfreevars; remaining > 0; remaining--) {
+                sq_arrayappend(vm, -1 - remaining);
+            }
+            set.overloads.push_back(overload);
+
+            if (set.byArity.size() <= static_cast<size_t>(binding.maxParams)) {
+                set.byArity.resize(binding.maxParams + 1, 0);
+            }
+            for (SQInteger n = binding.minParams; n <= binding.maxParams; n++) {
+                set.byArity[n] |= bit;
+            }
+
+            // Parameters past the typemask accept any type
+            const std::vector<uint64_t> masks = compileTypemask(binding.typemask);
+            if (set.byType.size() < static_cast<size_t>(binding.maxParams)) {
+                std::array<uint64_t, numOfRawTypes> previous;
+                previous.fill(bit - 1);
+                set.byType.resize(binding.maxParams, previous);
+            }
+            for (size_t pos = 0; pos < set.byType.size(); pos++) {
+                const uint64_t mask = pos < masks.size() ? masks[pos] : ~0ULL;
+                for (size_t type = 0; type < numOfRawTypes; type++) {
+                    if (mask & (1ULL << type)) {
+                        set.byType[pos][type] |= bit;
+                    }
+                }
+            }
+
+            set.byClass.resize(set.byType.size());
+            for (size_t pos = 0; pos < set.byClass.size(); pos++) {
+                set.byClass[pos].resize(set.overloads.size(), 0);
+                if (pos < binding.paramTags.size()) {
+                    set.byClass[pos].back() = binding.paramTags[pos];
+                }
+            }
+        }
+
+        void newOverloadClosure(HSQUIRRELVM vm, const OverloadSet& set) {
+            sq_newclosure(vm, &dispatchOverload, 2);
+            sq_setnativeclosurename(vm, -1, set.name.c_str());
+        }
+    }
+}
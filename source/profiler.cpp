@@ -0,0 +1,37 @@
+#include "simplesquirrel/profiler.hpp"
+#include <squirrel.h>
+#include <string>
+#include <vector>
+
+namespace ssq {
+    namespace detail {
+        void sampleCallStack(HSQUIRRELVM vm, SamplingProfiler& profiler) {
+            // Innermost call first
+            static thread_local std::vector<SQStackInfos> frames;
+            frames.clear();
+            SQStackInfos si;
+            for (SQInteger level = 0; SQ_SUCCEEDED(sq_stackinfos(vm, level, &si)); level++) {
+                frames.push_back(si);
+            }
+            if (frames.empty()) {
+                return;
+            }
+
+            static thread_local std::string stack;
+            stack.clear();
+            for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+                if (!stack.empty()) {
+                    stack += ';';
+                }
+                stack += it->source != nullptr ? it->source : "unknown";
+                stack += ':';
+                stack += it->funcname != nullptr ? it->funcname : "unknown";
+                stack += ':';
+                stack += std::to_string(it->line);
+            }
+
+            profiler.stacks[stack]++;
+            profiler.samples++;
+        }
+    }
+}
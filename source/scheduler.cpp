@@ -0,0 +1,372 @@
+#include "simplesquirrel/scheduler.hpp"
+#include "simplesquirrel/vm.hpp"
+#include "simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+#include <cstring>
+
+namespace ssq {
+    static uint32_t slotIndex(Scheduler::ThreadId id) {
+        return static_cast<uint32_t>(id & 0xFFFFFFFF) - 1;
+    }
+
+    static uint32_t slotGeneration(Scheduler::ThreadId id) {
+        return static_cast<uint32_t>(id >> 32);
+    }
+
+    Scheduler::Scheduler(VM& vm, size_t stackSize):vm(vm.getHandle()), stackSize(stackSize), timerSeq(0),
+        numThreads(0), current(0) {
+        if (this->vm == nullptr) throw RuntimeException(nullptr, "VM is not initialised");
+
+        AllocatorScope scope(this->vm);
+
+        // Shared with the native functions, which outlive the scheduler if they're not removed
+        Scheduler** data = reinterpret_cast<Scheduler**>(sq_newuserdata(this->vm, sizeof(Scheduler*)));
+        *data = this;
+        sq_resetobject(&handle);
+        sq_getstackobj(this->vm, -1, &handle);
+        sq_addref(this->vm, &handle);
+        sq_pop(this->vm, 1);
+    }
+
+    Scheduler::~Scheduler() {
+        AllocatorScope scope(vm);
+        for (size_t i = 0; i < slots.size(); i++) {
+            // Free slots may keep the thread of their last occupant
+            sq_release(vm, &slots[i].thread);
+            sq_release(vm, &slots[i].value);
+        }
+
+        sq_pushobject(vm, handle);
+        Scheduler** data = nullptr;
+        sq_getuserdata(vm, -1, reinterpret_cast<SQUserPointer*>(&data), nullptr);
+        *data = nullptr;
+        sq_pop(vm, 1);
+        sq_release(vm, &handle);
+    }
+
+    void Scheduler::registerFunctions(Table& table) {
+        AllocatorScope scope(vm);
+        static const struct {
+            const char* name;
+            SQFUNCTION func;
+            SQInteger nparams;
+            const char* typemask;
+        } funcs[] = {
+            { "sleep", &Scheduler::sleepFunc, 2, ".n" },
+            { "wait", &Scheduler::waitFunc, 1, "." }
+        };
+
+        for (const auto& f : funcs) {
+            sq_pushobject(vm, table.getRaw());
+            sq_pushstring(vm, f.name, strlen(f.name));
+            sq_pushobject(vm, handle);
+            sq_newclosure(vm, f.func, 1);
+            sq_setparamscheck(vm, f.nparams, f.nparams, f.typemask);
+            sq_setnativeclosurename(vm, -1, f.name);
+            if (SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                sq_pop(vm, 1);
+                throw RuntimeException(vm, "Failed to add scheduler function '" + std::string(f.name) + "'!");
+            }
+            sq_pop(vm, 1);
+        }
+    }
+
+    Scheduler::ThreadId Scheduler::newThread() {
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            index = static_cast<uint32_t>(slots.size());
+            Slot slot;
+            sq_resetobject(&slot.thread);
+            sq_resetobject(&slot.value);
+            slot.generation = 0;
+            slot.state = State::FREE;
+            slots.push_back(slot);
+        }
+
+        Slot& slot = slots[index];
+        if (slot.thread._type != OT_THREAD) {
+            HSQUIRRELVM thread = sq_newthread(vm, static_cast<SQInteger>(stackSize));
+            if (thread == nullptr) {
+                freeSlots.push_back(index);
+                throw RuntimeException(vm, "Failed to create thread!");
+            }
+
+            sq_getstackobj(vm, -1, &slot.thread);
+            sq_addref(vm, &slot.thread);
+            sq_pop(vm, 1);
+        }
+        sq_resetobject(&slot.value);
+        slot.state = State::READY;
+        slot.started = false;
+        slot.pendingWake = false;
+        slot.nargs = 0;
+        slot.timer = 0;
+        numThreads++;
+
+        return (static_cast<ThreadId>(slot.generation) << 32) | (index + 1);
+    }
+
+    HSQUIRRELVM Scheduler::getThread(ThreadId id) const {
+        const Slot* slot = find(id);
+        return slot != nullptr ? slot->thread._unVal.pThread : nullptr;
+    }
+
+    void Scheduler::start(ThreadId id, SQInteger nargs) {
+        find(id)->nargs = nargs;
+        ready.push_back(id);
+    }
+
+    Scheduler::Slot* Scheduler::find(ThreadId id) {
+        const uint32_t index = slotIndex(id);
+        if (id == 0 || index >= slots.size()) {
+            return nullptr;
+        }
+        Slot& slot = slots[index];
+        if (slot.state == State::FREE || slot.generation != slotGeneration(id)) {
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    const Scheduler::Slot* Scheduler::find(ThreadId id) const {
+        return const_cast<Scheduler*>(this)->find(id);
+    }
+
+    bool Scheduler::wake(ThreadId id) {
+        AllocatorScope scope(vm);
+        sq_pushnull(vm);
+        return wakeWithTop(id);
+    }
+
+    bool Scheduler::wakeWithTop(ThreadId id) {
+        Slot* slot = find(id);
+        if (slot == nullptr || slot->state == State::KILLED) {
+            sq_pop(vm, 1);
+            return false;
+        }
+
+        // Keep the value until the thread is resumed
+        sq_release(vm, &slot->value);
+        sq_getstackobj(vm, -1, &slot->value);
+        sq_addref(vm, &slot->value);
+        sq_pop(vm, 1);
+
+        if (slot->state == State::WAITING) {
+            slot->state = State::READY;
+            ready.push_back(id);
+        } else {
+            slot->pendingWake = true;
+        }
+        return true;
+    }
+
+    void Scheduler::notify(ThreadId id) {
+        std::lock_guard<std::mutex> lock(notifiedMutex);
+        notified.push_back(id);
+    }
+
+    bool Scheduler::kill(ThreadId id) {
+        Slot* slot = find(id);
+        if (slot == nullptr || slot->state == State::KILLED) {
+            return false;
+        }
+        if (id == current) {
+            slot->state = State::KILLED;
+        } else {
+            release(id);
+        }
+        return true;
+    }
+
+    bool Scheduler::isAlive(ThreadId id) const {
+        const Slot* slot = find(id);
+        return slot != nullptr && slot->state != State::KILLED;
+    }
+
+    Scheduler::ThreadId Scheduler::getCurrent() const {
+        return current;
+    }
+
+    size_t Scheduler::getNumOfThreads() const {
+        return numThreads;
+    }
+
+    void Scheduler::setErrorHandler(const ErrorHandler& handler) {
+        errorHandler = handler;
+    }
+
+    size_t Scheduler::update() {
+        if (current != 0) {
+            throw RuntimeException(nullptr, "Scheduler cannot be updated from one of its threads");
+        }
+
+        std::vector<ThreadId> woken;
+        {
+            std::lock_guard<std::mutex> lock(notifiedMutex);
+            woken.swap(notified);
+        }
+        for (ThreadId id : woken) {
+            wake(id);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        while (!timers.empty() && timers.top().at <= now) {
+            const Timer timer = timers.top();
+            timers.pop();
+            Slot* slot = find(timer.id);
+            // Timers of killed or woken threads are left in the heap and skipped here
+            if (slot != nullptr && slot->state == State::SLEEPING && slot->timer == timer.seq) {
+                slot->state = State::READY;
+                ready.push_back(timer.id);
+            }
+        }
+
+        size_t resumed = 0;
+        for (size_t count = ready.size(); count > 0; count--) {
+            const ThreadId id = ready.front();
+            ready.pop_front();
+            const Slot* slot = find(id);
+            if (slot != nullptr && slot->state == State::READY) {
+                resume(id);
+                resumed++;
+            }
+        }
+        return resumed;
+    }
+
+    std::chrono::steady_clock::duration Scheduler::getTimeToNextUpdate() const {
+        if (!ready.empty()) {
+            return std::chrono::steady_clock::duration::zero();
+        }
+        if (timers.empty()) {
+            return std::chrono::steady_clock::duration::max();
+        }
+        const auto now = std::chrono::steady_clock::now();
+        const auto at = timers.top().at;
+        return at > now ? at - now : std::chrono::steady_clock::duration::zero();
+    }
+
+    void Scheduler::resume(ThreadId id) {
+        // Slots may move while the thread runs, as it can spawn other threads
+        Slot* slot = find(id);
+        HSQUIRRELVM thread = slot->thread._unVal.pThread;
+        slot->state = State::RUNNING;
+        current = id;
+
+        SQRESULT result;
+        {
+            AllocatorScope scope(vm);
+            detail::ExecutionScope execution(thread);
+            if (!slot->started) {
+                slot->started = true;
+                result = sq_call(thread, slot->nargs + 1, SQFalse, SQTrue);
+            } else {
+                // Returned by sleep() or wait(), so a wake while sleeping is consumed here
+                sq_pushobject(thread, slot->value);
+                sq_release(vm, &slot->value);
+                sq_resetobject(&slot->value);
+                slot->pendingWake = false;
+                result = sq_wakeupvm(thread, SQTrue, SQFalse, SQTrue, SQFalse);
+            }
+        }
+
+        current = 0;
+        slot = find(id);
+        if (SQ_FAILED(result)) {
+            // Taken before releasing, which clears the stack of the thread
+            AllocatorScope scope(vm);
+            const RuntimeException error(thread, "Thread failed");
+            release(id);
+            if (errorHandler) {
+                errorHandler(id, error);
+            }
+        } else if (sq_getvmstate(thread) != SQ_VMSTATE_SUSPENDED || slot->state == State::KILLED) {
+            release(id);
+        } else if (slot->state == State::RUNNING) {
+            // Suspended by other means than sleep() or wait(), such as suspend() of the base library
+            slot->state = State::WAITING;
+        }
+    }
+
+    void Scheduler::release(ThreadId id) {
+        Slot* slot = find(id);
+        HSQUIRRELVM thread = slot->thread._unVal.pThread;
+        if (sq_getvmstate(thread) == SQ_VMSTATE_IDLE) {
+            // Kept for the next thread spawned into this slot
+            sq_settop(thread, 0);
+        } else {
+            // A suspended thread still holds its call stack
+            sq_release(vm, &slot->thread);
+            sq_resetobject(&slot->thread);
+        }
+        sq_release(vm, &slot->value);
+        sq_resetobject(&slot->value);
+        slot->state = State::FREE;
+        slot->generation++;
+        freeSlots.push_back(slotIndex(id));
+        numThreads--;
+    }
+
+    Scheduler* Scheduler::getScheduler(HSQUIRRELVM vm) {
+        Scheduler** data = nullptr;
+        if (SQ_FAILED(sq_getuserdata(vm, -1, reinterpret_cast<SQUserPointer*>(&data), nullptr)) || *data == nullptr) {
+            return nullptr;
+        }
+        Scheduler* scheduler = *data;
+        const Slot* slot = scheduler->find(scheduler->current);
+        if (slot == nullptr || slot->thread._unVal.pThread != vm) {
+            return nullptr;
+        }
+        return scheduler;
+    }
+
+    SQInteger Scheduler::sleepFunc(HSQUIRRELVM vm) {
+        Scheduler* scheduler = getScheduler(vm);
+        if (scheduler == nullptr) {
+            return sq_throwerror(vm, "sleep() can only be called from a thread of a scheduler");
+        }
+
+        SQFloat seconds = 0;
+        sq_getfloat(vm, 2, &seconds);
+
+        Slot* slot = scheduler->find(scheduler->current);
+        if (slot->state == State::KILLED) {
+            // Released as soon as it gives up control
+        } else if (seconds <= 0) {
+            slot->state = State::READY;
+            scheduler->ready.push_back(scheduler->current);
+        } else {
+            const auto duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(seconds));
+            slot->state = State::SLEEPING;
+            slot->timer = ++scheduler->timerSeq;
+            scheduler->timers.push(Timer{ std::chrono::steady_clock::now() + duration, scheduler->current, slot->timer });
+        }
+        return sq_suspendvm(vm);
+    }
+
+    SQInteger Scheduler::waitFunc(HSQUIRRELVM vm) {
+        Scheduler* scheduler = getScheduler(vm);
+        if (scheduler == nullptr) {
+            return sq_throwerror(vm, "wait() can only be called from a thread of a scheduler");
+        }
+
+        Slot* slot = scheduler->find(scheduler->current);
+        if (slot->pendingWake) {
+            // Woken before it started waiting
+            slot->pendingWake = false;
+            sq_pushobject(vm, slot->value);
+            sq_release(scheduler->vm, &slot->value);
+            sq_resetobject(&slot->value);
+            return 1;
+        }
+
+        if (slot->state != State::KILLED) {
+            slot->state = State::WAITING;
+        }
+        return sq_suspendvm(vm);
+    }
+}
@@ -3,6 +3,17 @@
 #include <squirrel.h>
 #include <forward_list>
 
+static SQInteger squirrel_ostream_write(SQUserPointer stream, SQUserPointer data, SQInteger size)
+{
+  std::ostream* out = reinterpret_cast<std::ostream*>(stream);
+
+  out->write(reinterpret_cast<const char*>(data), size);
+  if (!*out)
+    return -1;
+
+  return size;
+}
+
 namespace ssq {
     Script::Script(HSQUIRRELVM vm) :Object(vm) {
 
@@ -12,6 +23,19 @@ namespace ssq {
         Object::swap(other);
     }
 
+    void Script::save(std::ostream& out) const {
+        if (isEmpty()) {
+            throw RuntimeException(vm, "Empty script object.");
+        }
+
+        sq_pushobject(vm, obj);
+        if (SQ_FAILED(sq_writeclosure(vm, squirrel_ostream_write, &out))) {
+            sq_pop(vm, 1);
+            throw RuntimeException(vm, "Script cannot be saved as bytecode!");
+        }
+        sq_pop(vm, 1);
+    }
+
     Script::Script(Script&& other) NOEXCEPT :Object(std::forward<Object>(other)) {
 
     }
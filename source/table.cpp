@@ -18,6 +18,7 @@ namespace ssq {
     }
 
     Table::Table(HSQUIRRELVM vm):Object(vm) {
+        detail::ObjectAllocatorScope scope(vm);
         sq_newtable(vm);
         sq_getstackobj(vm, -1, &obj);
         sq_addref(vm, &obj);
@@ -49,6 +50,7 @@ namespace ssq {
 
     Table Table::addTable(const char* name) {
         assert(sizeof(name) < static_cast<size_t>(std::numeric_limits<SQInteger>::max()));
+        detail::ObjectAllocatorScope scope(vm);
         Table table(vm);
         sq_pushobject(vm, obj);
         sq_pushstring(vm, name, strlen(name));
@@ -85,10 +87,22 @@ namespace ssq {
         return true;
     }
 
+    bool Table::hasEntry(const Key& key) const {
+        sq_pushobject(vm, obj);
+        sq_pushobject(vm, key.getRaw());
+        if(SQ_FAILED(sq_get(vm, -2))) {
+            sq_pop(vm, 1); // pop table
+            return false;
+        }
+        sq_pop(vm, 2); // pop result and table
+        return true;
+    }
+
     void Table::rename(const char* old_name, const char* new_name) {
         assert(sizeof(old_name) < static_cast<size_t>(std::numeric_limits<SQInteger>::max()));
         assert(sizeof(new_name) < static_cast<size_t>(std::numeric_limits<SQInteger>::max()));
 
+        detail::ObjectAllocatorScope scope(vm);
         const SQInteger old_top = sq_gettop(vm);
         sq_pushobject(vm, obj);
 
@@ -114,6 +128,13 @@ namespace ssq {
         sq_pop(vm, 1); // pop table
     }
 
+    void Table::remove(const Key& key) {
+        sq_pushobject(vm, obj);
+        sq_pushobject(vm, key.getRaw());
+        sq_deleteslot(vm, -2, SQFalse);
+        sq_pop(vm, 1); // pop table
+    }
+
     void Table::clear() {
         sq_pushobject(vm, obj);
         sq_clear(vm, -1);
@@ -11,20 +11,178 @@
 #include <cstring>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "simplesquirrel/object.hpp"
 #include "simplesquirrel/enum.hpp"
+#include "simplesquirrel/buffer.hpp"
+#include "simplesquirrel/profiler.hpp"
 #include "simplesquirrel/vm.hpp"
 
+#ifdef SSQ_SQUIRREL_INTERRUPT
+// Defined in the copy of sqvm.cpp patched by CMakeLists.txt
+extern SQInteger (*sq_vm_interrupt)(HSQUIRRELVM v, SQInteger point);
+#endif
+
+// Feeds the lexer from an input stream, reading it in chunks instead of one get() per character
+struct squirrel_istream_buffer
+{
+  std::istream* in;
+  size_t pos;
+  size_t len;
+  char data[4096];
+};
+
 static SQInteger squirrel_istream_read_char(SQUserPointer stream)
+{
+  squirrel_istream_buffer* buffer = reinterpret_cast<squirrel_istream_buffer*>(stream);
+
+  if (buffer->pos == buffer->len) {
+    buffer->in->read(buffer->data, sizeof(buffer->data));
+    buffer->pos = 0;
+    buffer->len = static_cast<size_t>(buffer->in->gcount());
+    if (buffer->len == 0)
+      return 0;
+  }
+
+  return static_cast<unsigned char>(buffer->data[buffer->pos++]);
+}
+
+static SQInteger squirrel_istream_read(SQUserPointer stream, SQUserPointer data, SQInteger size)
 {
   std::istream* in = reinterpret_cast<std::istream*>(stream);
 
-  const SQInteger c = in->get();
-  if (in->eof())
-    return 0;
+  in->read(reinterpret_cast<char*>(data), size);
+  if (in->gcount() != size)
+    return -1;
 
-  return c;
+  return size;
+}
+
+// Returns false if the data is not plain text source (bytecode or UCS-2), otherwise provides the offset past the UTF-8 BOM
+static bool squirrel_plain_source_offset(const char* data, size_t size, size_t& offset)
+{
+  offset = 0;
+  if (size >= 2) {
+    const unsigned short tag = static_cast<unsigned char>(data[0]) | (static_cast<unsigned char>(data[1]) << 8);
+    if (tag == SQ_BYTECODE_STREAM_TAG || tag == 0xFEFF || tag == 0xFFFE)
+      return false;
+  }
+  if (size >= 3 && static_cast<unsigned char>(data[0]) == 0xEF &&
+      static_cast<unsigned char>(data[1]) == 0xBB && static_cast<unsigned char>(data[2]) == 0xBF)
+    offset = 3;
+  return true;
+}
+
+// Read-only mapping of a whole file, data is null if the file cannot be mapped
+struct squirrel_mapped_file
+{
+  const char* data;
+  size_t size;
+
+  explicit squirrel_mapped_file(const char* path) : data(nullptr), size(0)
+  {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || static_cast<unsigned long long>(fileSize.QuadPart) > SIZE_MAX) {
+      // Cannot be mapped as a whole
+    } else if (fileSize.QuadPart == 0) {
+      data = "";
+    } else {
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping != nullptr) {
+        data = reinterpret_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        size = data != nullptr ? static_cast<size_t>(fileSize.QuadPart) : 0;
+        CloseHandle(mapping);
+      }
+    }
+    CloseHandle(file);
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+      if (st.st_size == 0) {
+        data = "";
+      } else {
+        void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+          data = reinterpret_cast<const char*>(mapped);
+          size = static_cast<size_t>(st.st_size);
+        }
+      }
+    }
+    close(fd);
+#endif
+  }
+
+  ~squirrel_mapped_file()
+  {
+    if (size == 0)
+      return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<char*>(data), size);
+#endif
+  }
+
+  squirrel_mapped_file(const squirrel_mapped_file&) = delete;
+  squirrel_mapped_file& operator = (const squirrel_mapped_file&) = delete;
+};
+
+// FNV-1a
+static uint64_t squirrel_hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// The cache file name depends on the source, its name (kept in the debug info) and the bytecode format
+static std::string squirrel_cache_path(const std::string& dir, const char* path, const std::string& source)
+{
+  const SQInteger version = sq_getversion();
+  const unsigned char sizes[] = { sizeof(SQChar), sizeof(SQInteger), sizeof(SQFloat), sizeof(void*) };
+
+  uint64_t hash = squirrel_hash(source.data(), source.size());
+  hash = squirrel_hash(path, strlen(path), hash);
+  hash = squirrel_hash(&version, sizeof(version), hash);
+  hash = squirrel_hash(sizes, sizeof(sizes), hash);
+
+  std::stringstream ss;
+  ss << dir;
+  if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+    ss << '/';
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash << ".cnut";
+  return ss.str();
 }
 
 namespace ssq {
@@ -40,15 +198,478 @@ namespace ssq {
         return *static_cast<VM*>(ptr);
     }
 
-    VM::VM():Table(), foreignPtr(nullptr) {
+    namespace detail {
+        // Each VM only changes it from the thread using the VM, so relaxed loads see its own changes
+        std::atomic<size_t> numOfInterruptibleVMs(0);
+
+        Allocator* getAllocator(HSQUIRRELVM vm) {
+            SQUserPointer ptr = sq_getsharedforeignptr(vm);
+            return ptr != nullptr ? static_cast<VM*>(ptr)->accounting.get() : nullptr;
+        }
+
+        const char* getInterrupt(HSQUIRRELVM vm, SafePoint point) {
+            SQUserPointer ptr = sq_getsharedforeignptr(vm);
+            if (ptr == nullptr) {
+                return nullptr;
+            }
+            VM* mainVM = static_cast<VM*>(ptr);
+            ExecutionState& state = mainVM->execution;
+            AccountingAllocator* accounting = mainVM->accounting.get();
+            // The scope of the call from C++ is already entered, so the outermost one has depth 1
+            const bool collect = accounting != nullptr && accounting->isCollectRequested() &&
+                (point == SafePoint::SCRIPT || (point == SafePoint::CALL_FROM_CPP && state.depth <= 1));
+            if (!state.armed && !collect && (accounting == nullptr || !accounting->isOverLimit())) {
+                return nullptr;
+            }
+
+            if (collect) {
+                mainVM->collectRequestedGarbage();
+            }
+            // Once the script caught the error, it may go on until it allocates again
+            if (accounting != nullptr && accounting->isOverLimit() &&
+                (!state.memoryCaught || accounting->getStats().allocations != state.caughtAllocations)) {
+                if (state.stopReason == StopReason::NONE) {
+                    state.stopReason = StopReason::MEMORY;
+                }
+                return "Memory limit exceeded";
+            }
+            if (state.depth != 0) {
+                if (state.stopReason == StopReason::INSTRUCTIONS) {
+                    return "Instruction budget exceeded";
+                } else if (state.stopReason == StopReason::TIME) {
+                    return "Time budget exceeded";
+                }
+            }
+            return nullptr;
+        }
+
+        // Counts a line, call, return or loop iteration, stopping the script at the next safe point once the budget runs out
+        static void countExecution(ExecutionState& state) {
+            if (state.armed) {
+                return;
+            }
+
+            const ExecutionBudget& budget = state.budget;
+            state.count++;
+            StopReason reason = StopReason::NONE;
+            if (budget.instructions != 0 && state.count >= budget.instructions) {
+                reason = StopReason::INSTRUCTIONS;
+            } else if (budget.microseconds != 0 && (state.count & 0xFF) == 0 &&
+                std::chrono::steady_clock::now() >= state.deadline) {
+                // Reading the clock is far more expensive than an event, so it's only done every 256 events
+                reason = StopReason::TIME;
+            }
+
+            if (reason != StopReason::NONE) {
+                state.stopReason = reason;
+                state.armed = true;
+            }
+        }
+
+        SQInteger interruptExecution(HSQUIRRELVM vm, SQInteger point) {
+            SQUserPointer ptr = sq_getsharedforeignptr(vm);
+            if (ptr == nullptr) {
+                return 0;
+            }
+            VM* mainVM = static_cast<VM*>(ptr);
+            ExecutionState& state = mainVM->execution;
+            AccountingAllocator* accounting = mainVM->accounting.get();
+
+            if (point == 't') {
+                // Scripts can only catch running out of their budget if they are allowed to
+                if (state.depth != 0 && state.armed && state.budget.uncatchable) {
+                    return 1;
+                }
+                if (accounting == nullptr || !accounting->isOverLimit()) {
+                    return 0;
+                }
+                // Running out of memory can be caught once per call, to free some
+                if (!state.memoryCaught) {
+                    state.memoryCaught = true;
+                    state.caughtAllocations = accounting->getStats().allocations;
+                    return 0;
+                }
+                return accounting->getStats().allocations != state.caughtAllocations ? 1 : 0;
+            }
+            if (point == 'j' && state.depth != 0) {
+                // Loops without line events, such as while (true) {}, still use up the budget
+                countExecution(state);
+            }
+
+            const char* reason = getInterrupt(vm, SafePoint::SCRIPT);
+            if (reason == nullptr) {
+                return 0;
+            }
+            sq_throwerror(vm, reason);
+            return 1;
+        }
+
+        ExecutionState* getExecutionState(HSQUIRRELVM vm) {
+            SQUserPointer ptr = sq_getsharedforeignptr(vm);
+            return ptr != nullptr ? &static_cast<VM*>(ptr)->execution : nullptr;
+        }
+
+        NativeCallCounters* getNativeCallCounters(HSQUIRRELVM vm, const char* name) {
+            SQUserPointer ptr = sq_getsharedforeignptr(vm);
+            // Nodes of the map never move, so bindings can keep the pointer
+            return ptr != nullptr ? &static_cast<VM*>(ptr)->nativeCalls[name] : nullptr;
+        }
+
+        // Samples the call stack and counts the budget, after calling the hook set by the user
+        static void executionHook(HSQUIRRELVM vm, SQInteger type, const SQChar* sourcename, SQInteger line, const SQChar* funcname) {
+            ExecutionState* state = getExecutionState(vm);
+            if (state == nullptr) {
+                return;
+            }
+            if (state->userHook != nullptr) {
+                state->userHook(vm, type, sourcename, line, funcname);
+            }
+            if (state->depth == 0) {
+                return;
+            }
+            if (state->profiler != nullptr) {
+                tickProfiler(vm, *state->profiler);
+            }
+            countExecution(*state);
+        }
+
+        ExecutionScope::ExecutionScope(HSQUIRRELVM vm):vm(vm), state(getExecutionState(vm)), hooked(false) {
+            if (state == nullptr) {
+                return;
+            }
+
+            if (state->depth++ == 0) {
+                state->outermost = vm;
+                state->count = 0;
+                state->stopReason = StopReason::NONE;
+                state->armed = false;
+                state->memoryCaught = false;
+                if (state->budget.microseconds != 0) {
+                    state->deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(state->budget.microseconds);
+                }
+            }
+
+            if (state->budget.instructions != 0 || state->budget.microseconds != 0 || state->profiler != nullptr || state->watchMemory) {
+                sq_setnativedebughook(vm, &executionHook);
+                hooked = true;
+            }
+        }
+
+        ExecutionScope::~ExecutionScope() {
+            if (state == nullptr) {
+                return;
+            }
+
+            const bool outermost = --state->depth == 0;
+            // The outermost VM is still running nested calls made on it
+            if (hooked && (outermost || vm != state->outermost)) {
+                sq_setnativedebughook(vm, state->userHook);
+            }
+            if (outermost) {
+                // Keep the stop reason, the budget is counted again by the next call
+                state->armed = false;
+                state->memoryCaught = false;
+            }
+        }
+    }
+
+    Allocator* VM::getAllocator() const {
+        if (vm == nullptr) {
+            return allocator.get();
+        }
+        return VM::getMain(vm).allocator.get();
+    }
+
+    void VM::setNativeDebugHook(SQDEBUGHOOK hook) {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        mainVM.execution.userHook = hook;
+        if (vm != nullptr) {
+            sq_setnativedebughook(vm, hook);
+        }
+    }
+
+    SQDEBUGHOOK VM::getNativeDebugHook() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.execution.userHook;
+    }
+
+    void VM::setDebugInfo(bool enable) {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        mainVM.debugInfo = enable;
+        mainVM.updateDebugInfo();
+    }
+
+    bool VM::isDebugInfoEnabled() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.debugInfo;
+    }
+
+    void VM::updateInterruptible() {
+        const ExecutionBudget& budget = execution.budget;
+        const bool interruptible = budget.instructions != 0 || budget.microseconds != 0 || execution.watchMemory;
+        if (interruptible != execution.interruptible) {
+            execution.interruptible = interruptible;
+            if (interruptible) {
+                detail::numOfInterruptibleVMs.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                detail::numOfInterruptibleVMs.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void VM::updateDebugInfo() {
+        if (vm == nullptr) {
+            return;
+        }
+        // Budgets and limits act at line events, the profiler samples the lines being run
+        const bool needed = execution.budget.instructions != 0 || execution.profiler != nullptr || execution.watchMemory;
+        sq_enabledebuginfo(vm, debugInfo || needed ? SQTrue : SQFalse);
+    }
+
+    void VM::setExecutionBudget(const ExecutionBudget& budget) {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        mainVM.execution.budget = budget;
+        mainVM.updateDebugInfo();
+        mainVM.updateInterruptible();
+    }
+
+    const ExecutionBudget& VM::getExecutionBudget() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.execution.budget;
+    }
+
+    StopReason VM::getStopReason() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.execution.stopReason;
+    }
+
+    size_t VM::collectGarbage() {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        if (mainVM.vm == nullptr) {
+            return 0;
+        }
+
+        AllocatorScope scope(mainVM.accounting.get());
+        const auto start = std::chrono::steady_clock::now();
+        const SQInteger result = sq_collectgarbage(mainVM.vm);
+        const uint64_t micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        // Negative if Squirrel is built without the garbage collector
+        const size_t freed = result > 0 ? static_cast<size_t>(result) : 0;
+
+        GarbageCollectionStats& stats = mainVM.gcStats;
+        stats.collections++;
+        stats.lastFreed = freed;
+        stats.totalFreed += freed;
+        stats.lastMicroseconds = micros;
+        stats.maxMicroseconds = std::max(stats.maxMicroseconds, micros);
+        stats.totalMicroseconds += micros;
+
+        if (mainVM.accounting) {
+            mainVM.gcAllocations = mainVM.accounting->getStats().allocations;
+            mainVM.accounting->resetCollect();
+        }
+        return freed;
+    }
+
+    void VM::collectRequestedGarbage() {
+        if (gcPauses == 0) {
+            collectGarbage();
+        }
+    }
+
+    void VM::setGarbageCollectionInterval(size_t allocations) {
+#ifndef SSQ_CUSTOM_ALLOCATORS
+        // Scripts would never reach the interval, only simplesquirrel's own allocations are counted
+        throw RuntimeException(vm, "Garbage collection intervals need SSQ_CUSTOM_ALLOCATORS!");
+#else
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        if (mainVM.accounting) {
+            mainVM.accounting->setCollectInterval(allocations);
+            mainVM.execution.watchMemory = allocations != 0 || mainVM.accounting->getStats().limit != 0;
+            mainVM.updateDebugInfo();
+            mainVM.updateInterruptible();
+        }
+#endif
+    }
+
+    size_t VM::getGarbageCollectionInterval() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.accounting ? mainVM.accounting->getCollectInterval() : 0;
+    }
+
+    bool VM::collectGarbageAtIdle(size_t minAllocations) {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        if (mainVM.vm == nullptr || mainVM.gcPauses != 0 || !mainVM.accounting) {
+            return false;
+        }
+#ifdef SSQ_CUSTOM_ALLOCATORS
+        if (mainVM.accounting->getStats().allocations - mainVM.gcAllocations < minAllocations) {
+            return false;
+        }
+#else
+        (void)minAllocations; // Allocations of scripts are not counted
+#endif
+        mainVM.collectGarbage();
+        return true;
+    }
+
+    void VM::pauseGarbageCollection() {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        mainVM.gcPauses++;
+    }
+
+    void VM::resumeGarbageCollection() {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        assert(mainVM.gcPauses != 0);
+        if (--mainVM.gcPauses == 0 && mainVM.accounting && mainVM.accounting->isCollectRequested()) {
+            mainVM.collectGarbage();
+        }
+    }
+
+    bool VM::isGarbageCollectionPaused() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.gcPauses != 0;
+    }
+
+    const GarbageCollectionStats& VM::getGarbageCollectionStats() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.gcStats;
+    }
+
+    std::vector<NativeCallStats> VM::getNativeCallStats() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        std::vector<NativeCallStats> result;
+        result.reserve(mainVM.nativeCalls.size());
+        for (const auto& pair : mainVM.nativeCalls) {
+            const detail::NativeCallCounters& counters = pair.second;
+            NativeCallStats stats;
+            stats.name = pair.first;
+            stats.calls = counters.calls.load(std::memory_order_relaxed);
+            stats.exceptions = counters.exceptions.load(std::memory_order_relaxed);
+            stats.totalNanoseconds = counters.totalNanoseconds.load(std::memory_order_relaxed);
+            stats.maxNanoseconds = counters.maxNanoseconds.load(std::memory_order_relaxed);
+            result.push_back(stats);
+        }
+        std::sort(result.begin(), result.end(), [](const NativeCallStats& a, const NativeCallStats& b) {
+            return a.totalNanoseconds > b.totalNanoseconds;
+        });
+        return result;
+    }
+
+    void VM::resetNativeCallStats() {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        for (auto& pair : mainVM.nativeCalls) {
+            pair.second.calls.store(0, std::memory_order_relaxed);
+            pair.second.exceptions.store(0, std::memory_order_relaxed);
+            pair.second.totalNanoseconds.store(0, std::memory_order_relaxed);
+            pair.second.maxNanoseconds.store(0, std::memory_order_relaxed);
+        }
+    }
 
+    void VM::startProfiling(uint64_t intervalMicroseconds) {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        if (!mainVM.profiler) {
+            mainVM.profiler.reset(new detail::SamplingProfiler());
+        }
+        mainVM.profiler->interval = std::chrono::microseconds(intervalMicroseconds);
+        mainVM.profiler->next = std::chrono::steady_clock::now();
+        mainVM.execution.profiler = mainVM.profiler.get();
+        mainVM.updateDebugInfo();
+    }
+
+    void VM::stopProfiling() {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        mainVM.execution.profiler = nullptr;
+        mainVM.updateDebugInfo();
     }
 
-    VM::VM(size_t stackSize, uint32_t flags):Table(), foreignPtr(nullptr) {
+    bool VM::isProfiling() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.execution.profiler != nullptr;
+    }
+
+    uint64_t VM::getNumOfProfileSamples() const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.profiler ? mainVM.profiler->samples : 0;
+    }
+
+    void VM::writeCollapsedStacks(std::ostream& out) const {
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        if (!mainVM.profiler) {
+            return;
+        }
+        for (const auto& pair : mainVM.profiler->stacks) {
+            out << pair.first << ' ' << pair.second << '\n';
+        }
+    }
+
+    void VM::resetProfile() {
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        if (mainVM.profiler) {
+            mainVM.profiler->stacks.clear();
+            mainVM.profiler->samples = 0;
+        }
+    }
+
+    GarbageCollectionPause::GarbageCollectionPause(VM& vm):vm(vm) {
+        vm.pauseGarbageCollection();
+    }
+
+    GarbageCollectionPause::~GarbageCollectionPause() {
+        vm.resumeGarbageCollection();
+    }
+
+    MemoryStats VM::getMemoryStats() const {
+#ifndef SSQ_CUSTOM_ALLOCATORS
+        throw RuntimeException(vm, "Memory of scripts is only counted when built with SSQ_CUSTOM_ALLOCATORS!");
+#else
+        const VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        return mainVM.accounting ? mainVM.accounting->getStats() : MemoryStats();
+#endif
+    }
+
+    void VM::setMemoryLimit(size_t bytes) {
+#ifndef SSQ_CUSTOM_ALLOCATORS
+        // Squirrel would allocate past any limit without being counted
+        throw RuntimeException(vm, "Memory limits need SSQ_CUSTOM_ALLOCATORS!");
+#else
+        VM& mainVM = vm != nullptr ? VM::getMain(vm) : *this;
+        if (mainVM.accounting) {
+            mainVM.accounting->setLimit(bytes);
+            mainVM.execution.watchMemory = bytes != 0 || mainVM.accounting->getCollectInterval() != 0;
+            mainVM.updateDebugInfo();
+            mainVM.updateInterruptible();
+        }
+#endif
+    }
+
+    VM::VM():Table(), threadPoolSize(16), gcStats(), gcPauses(0), gcAllocations(0), debugInfo(false), foreignPtr(nullptr) {
+
+    }
+
+    VM::VM(size_t stackSize, uint32_t flags):VM(stackSize, flags, nullptr) {
+
+    }
+
+    VM::VM(size_t stackSize, uint32_t flags, std::shared_ptr<Allocator> allocator):Table(),
+        threadPoolSize(16), allocator(std::move(allocator)), accounting(new detail::AccountingAllocator(this->allocator)),
+        gcStats(), gcPauses(0), gcAllocations(0), debugInfo(false), foreignPtr(nullptr) {
+        AllocatorScope scope(accounting.get());
+
+#ifdef SSQ_SQUIRREL_INTERRUPT
+        // Squirrel asks every VM through the same function, it's set once for all of them
+        static const bool interruptSet = (sq_vm_interrupt = &detail::interruptExecution, true);
+        (void)interruptSet;
+#endif
+
         vm = sq_open(stackSize);
         sq_setforeignptr(vm, this);
         sq_setsharedforeignptr(vm, this);
 
+        varGetKey = Key(vm, "_get");
+        varSetKey = Key(vm, "_set");
+
         registerStdlib(flags);
 
         setPrintFunc(&VM::defaultPrintFunc, &VM::defaultErrorFunc);
@@ -63,7 +684,7 @@ namespace ssq {
         sq_pop(vm, 1);
     }
 
-    VM::VM(const HSQOBJECT& threadObj):Table(), foreignPtr(nullptr) {
+    VM::VM(const HSQOBJECT& threadObj):Table(), threadPoolSize(0), gcStats(), gcPauses(0), gcAllocations(0), debugInfo(false), foreignPtr(nullptr) {
         assert(threadObj._type == OT_THREAD);
 
         vm = threadObj._unVal.pThread;
@@ -77,20 +698,31 @@ namespace ssq {
     }
 
     void VM::destroy() {
-        classMap.clear();
         if (vm != nullptr) {
             sq_resetobject(&obj);
 
             VM& mainVM = VM::getMain(vm);
             if (&mainVM == this) { // This is the main VM
-                // Destroy all threads
-                for (HSQOBJECT& threadObj : threads) {
-                    sq_resetobject(&threadObj);
+                {
+                    AllocatorScope scope(accounting.get());
+
+                    // Destroy all threads
+                    for (auto& pair : threads) {
+                        sq_resetobject(&pair.second.obj);
+                    }
+                    threads.clear();
+                    threadPool.clear();
+                    classRegistry.clear();
+                    varGetKey.reset();
+                    varSetKey.reset();
+
+                    sq_collectgarbage(vm);
+                    sq_close(vm);
                 }
-                threads.clear();
-
-                sq_collectgarbage(vm);
-                sq_close(vm);
+                detail::AccountingAllocator::release(accounting.release());
+                execution.budget = ExecutionBudget();
+                execution.watchMemory = false;
+                updateInterruptible();
             } else { // This is a thread VM, originating from simplesquirrel
                 mainVM.destroyThread(*this);
             }
@@ -120,11 +752,26 @@ namespace ssq {
         Object::swap(other);
         //swap(runtimeException, other.runtimeException);
         //swap(compileException, other.compileException);
-        swap(classMap, other.classMap);
+        classRegistry.swap(other.classRegistry);
+        varGetKey.swap(other.varGetKey);
+        varSetKey.swap(other.varSetKey);
+        threads.swap(other.threads);
+        threadPool.swap(other.threadPool);
+        swap(threadPoolSize, other.threadPoolSize);
+        swap(compileCacheDir, other.compileCacheDir);
+        swap(allocator, other.allocator);
+        swap(accounting, other.accounting);
+        swap(execution, other.execution);
+        swap(gcStats, other.gcStats);
+        swap(gcPauses, other.gcPauses);
+        swap(gcAllocations, other.gcAllocations);
+        swap(debugInfo, other.debugInfo);
+        nativeCalls.swap(other.nativeCalls);
+        swap(profiler, other.profiler);
         swap(foreignPtr, other.foreignPtr);
     }
         
-    VM::VM(VM&& other) NOEXCEPT :Table(), foreignPtr(nullptr) {
+    VM::VM(VM&& other) NOEXCEPT :Table(), threadPoolSize(16), gcStats(), gcPauses(0), gcAllocations(0), debugInfo(false), foreignPtr(nullptr) {
         swap(other);
     }
 
@@ -141,6 +788,8 @@ namespace ssq {
             sqstd_register_systemlib(vm);
         if(flags & ssq::Libs::STRING)
             sqstd_register_stringlib(vm);
+        if(flags & ssq::Libs::BUFFER)
+            detail::registerBufferLib(vm);
         sq_pop(vm, 1);
     }
 
@@ -190,6 +839,7 @@ namespace ssq {
     }
 
     Script VM::compileSource(const char* source, const char* name) {
+        AllocatorScope scope(vm);
         Script script(vm);
         if (SQ_FAILED(sq_compilebuffer(vm, source, strlen(source), name, true))) {
             //if (!compileException)
@@ -204,8 +854,12 @@ namespace ssq {
     }
 
     Script VM::compileSource(std::istream& source, const char* name) {
+        AllocatorScope scope(vm);
         Script script(vm);
-        if (SQ_FAILED(sq_compile(vm, squirrel_istream_read_char, &source, name, SQTrue))) {
+        squirrel_istream_buffer buffer;
+        buffer.in = &source;
+        buffer.pos = buffer.len = 0;
+        if (SQ_FAILED(sq_compile(vm, squirrel_istream_read_char, &buffer, name, SQTrue))) {
             //if (!compileException)
                 throw CompileException(vm, "Source cannot be compiled!");
             //throw *compileException;
@@ -218,6 +872,47 @@ namespace ssq {
     }
 
     Script VM::compileFile(const char* path) {
+        AllocatorScope scope(vm);
+        const std::string& cacheDir = VM::getMain(vm).compileCacheDir;
+        if (!cacheDir.empty()) {
+            std::ifstream file(path, std::ios::binary);
+            std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            size_t offset;
+            if (file && squirrel_plain_source_offset(source.data(), source.size(), offset)) {
+                const std::string cachePath = squirrel_cache_path(cacheDir, path, source);
+
+                std::ifstream cached(cachePath, std::ios::binary);
+                if (cached) {
+                    try {
+                        return loadBytecode(cached);
+                    } catch (const CompileException&) {
+                        // Unusable cache entry, compile it again
+                    }
+                }
+
+                Script script(vm);
+                if (SQ_FAILED(sq_compilebuffer(vm, source.data() + offset, source.size() - offset, path, true))) {
+                    throw CompileException(vm, "Source cannot be compiled!");
+                }
+                sq_getstackobj(vm, -1, &script.getRaw());
+                sq_addref(vm, &script.getRaw());
+                sq_pop(vm, 1);
+
+                // Store the bytecode, failing to do so only means there is no cache entry
+                const std::string tempPath = cachePath + ".tmp";
+                {
+                    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+                    if (out) {
+                        script.save(out);
+                    }
+                }
+                if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+                    std::remove(tempPath.c_str());
+                }
+                return script;
+            }
+        }
+
         Script script(vm);
         if (SQ_FAILED(sqstd_loadfile(vm, path, true))) {
             //if (!compileException)
@@ -231,11 +926,73 @@ namespace ssq {
         return script;
     }
 
+    Script VM::compileFileMapped(const char* path) {
+        AllocatorScope scope(vm);
+        squirrel_mapped_file file(path);
+        if (file.data == nullptr) {
+            throw CompileException(vm, "File not found or cannot be read!");
+        }
+
+        size_t offset;
+        if (!squirrel_plain_source_offset(file.data, file.size, offset)) {
+            // Bytecode or UCS-2 source, sqstdlib knows how to load these
+            return compileFile(path);
+        }
+
+        Script script(vm);
+        if (SQ_FAILED(sq_compilebuffer(vm, file.data + offset, file.size - offset, path, true))) {
+            throw CompileException(vm, "Source cannot be compiled!");
+        }
+
+        sq_getstackobj(vm, -1, &script.getRaw());
+        sq_addref(vm, &script.getRaw());
+        sq_pop(vm, 1);
+        return script;
+    }
+
+    Script VM::loadBytecode(std::istream& in) {
+        AllocatorScope scope(vm);
+        Script script(vm);
+        if (SQ_FAILED(sq_readclosure(vm, squirrel_istream_read, &in))) {
+            throw CompileException(vm, "Bytecode cannot be read!");
+        }
+
+        sq_getstackobj(vm, -1, &script.getRaw());
+        sq_addref(vm, &script.getRaw());
+        sq_pop(vm, 1);
+        return script;
+    }
+
+    void VM::setCompileCache(const std::string& directory) {
+        VM::getMain(vm).compileCacheDir = directory;
+    }
+
+    const std::string& VM::getCompileCache() const {
+        return VM::getMain(vm).compileCacheDir;
+    }
+
+    std::string VM::getCompileCacheFile(const char* path) const {
+        const std::string& cacheDir = VM::getMain(vm).compileCacheDir;
+        if (cacheDir.empty()) {
+            return std::string();
+        }
+        std::ifstream file(path, std::ios::binary);
+        std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        size_t offset;
+        if (!file || !squirrel_plain_source_offset(source.data(), source.size(), offset)) {
+            return std::string();
+        }
+        return squirrel_cache_path(cacheDir, path, source);
+    }
+
     void VM::run(const Script& script, bool printCallstack) {
         if (script.isEmpty()) {
             throw RuntimeException(vm, "Empty script object.");
         }
 
+        detail::ExecutionScope execution(vm);
+        detail::checkInterrupt(vm, detail::SafePoint::CALL_FROM_CPP);
+        AllocatorScope scope(vm);
         const SQInteger old_top = sq_gettop(vm);
         sq_pushobject(vm, script.getRaw());
         sq_pushroottable(vm);
@@ -275,6 +1032,9 @@ namespace ssq {
             throw RuntimeException(vm, "Empty script object.");
         }
 
+        detail::ExecutionScope execution(vm);
+        detail::checkInterrupt(vm, detail::SafePoint::CALL_FROM_CPP);
+        AllocatorScope scope(vm);
         const SQInteger old_top = sq_gettop(vm);
         sq_pushobject(vm, script.getRaw());
         sq_pushroottable(vm);
@@ -309,23 +1069,40 @@ namespace ssq {
         }
     }
 
+    // Returns the stack-size class of a thread, the stack size rounded up to a power of two
+    static size_t threadStackClass(size_t stackSize) {
+        size_t size = 16;
+        while (size < stackSize) {
+            size *= 2;
+        }
+        return size;
+    }
+
     VM VM::newThread(size_t stackSize) {
+        AllocatorScope scope(vm);
         assert(VM::getMain(vm).getHandle() == vm); // Assert this is the main VM
 
-        HSQUIRRELVM thread = sq_newthread(vm, stackSize);
-        if (!thread)
-            throw RuntimeException(vm, "Failed to create thread!");
-
+        const size_t stackClass = threadStackClass(stackSize);
         HSQOBJECT threadObj;
         sq_resetobject(&threadObj);
-        if (SQ_FAILED(sq_getstackobj(vm, -1, &threadObj)))
-            throw RuntimeException(vm, "Failed to get Squirrel thread from stack!");
-        sq_addref(vm, &threadObj);
 
-        VM threadVM(threadObj);
-        threads.push_back(std::move(threadObj));
+        auto pool = threadPool.find(stackClass);
+        if (pool != threadPool.end() && !pool->second.empty()) {
+            threadObj = pool->second.back();
+            pool->second.pop_back();
+        } else {
+            HSQUIRRELVM thread = sq_newthread(vm, stackClass);
+            if (!thread)
+                throw RuntimeException(vm, "Failed to create thread!");
+
+            if (SQ_FAILED(sq_getstackobj(vm, -1, &threadObj)))
+                throw RuntimeException(vm, "Failed to get Squirrel thread from stack!");
+            sq_addref(vm, &threadObj);
+            sq_pop(vm, 1); // Pop thread
+        }
 
-        sq_pop(vm, 1); // Pop thread
+        VM threadVM(threadObj);
+        threads.emplace(threadObj._unVal.pThread, ThreadEntry{ threadObj, stackClass });
         return threadVM;
     }
 
@@ -333,20 +1110,65 @@ namespace ssq {
         assert(VM::getMain(vm).getHandle() == vm); // Assert this is the main VM
         assert(threadVM.vm);
 
-        auto it = std::find_if(threads.begin(), threads.end(),
-            [&threadVM](const HSQOBJECT& threadObj) {
-                return threadVM.vm == threadObj._unVal.pThread;
-            });
+        auto it = threads.find(threadVM.vm);
         assert(it != threads.end());
 
-        sq_resetobject(&*it);
+        AllocatorScope scope(accounting.get());
+        ThreadEntry entry = it->second;
         threads.erase(it);
-
-        sq_collectgarbage(vm);
         threadVM.vm = nullptr;
+
+        // No garbage collection here, a full pass costs far more than a short-lived thread
+        recycleThread(entry);
+    }
+
+    void VM::recycleThread(ThreadEntry& entry) {
+        HSQUIRRELVM thread = entry.obj._unVal.pThread;
+        std::vector<HSQOBJECT>& pool = threadPool[entry.stackSize];
+
+        // A suspended thread still holds its call stack, it cannot be reused
+        if (pool.size() >= threadPoolSize || sq_getvmstate(thread) != SQ_VMSTATE_IDLE) {
+            sq_release(vm, &entry.obj);
+            return;
+        }
+
+        sq_settop(thread, 0);
+        sq_setforeignptr(thread, nullptr);
+        // The thread VM may have replaced its root table
+        sq_pushroottable(vm);
+        sq_move(thread, vm, -1);
+        sq_setroottable(thread);
+        sq_pop(vm, 1);
+
+        pool.push_back(entry.obj);
+    }
+
+    void VM::setThreadPoolSize(size_t size) {
+        threadPoolSize = size;
+
+        AllocatorScope scope(accounting.get());
+        for (auto& pair : threadPool) {
+            while (pair.second.size() > threadPoolSize) {
+                sq_release(vm, &pair.second.back());
+                pair.second.pop_back();
+            }
+        }
+    }
+
+    size_t VM::getThreadPoolSize() const {
+        return threadPoolSize;
+    }
+
+    size_t VM::getNumOfPooledThreads() const {
+        size_t count = 0;
+        for (const auto& pair : threadPool) {
+            count += pair.second.size();
+        }
+        return count;
     }
 
     Enum VM::addEnum(const char* name) {
+        detail::ObjectAllocatorScope scope(vm);
         Enum enm(vm);
         sq_pushconsttable(vm);
         sq_pushstring(vm, name, strlen(name));
@@ -365,21 +1187,6 @@ namespace ssq {
         return *this;
     }
 
-    Object VM::callAndReturn(SQUnsignedInteger nparams, SQInteger top) const {
-        if(SQ_FAILED(sq_call(vm, 1 + nparams, SQTrue, SQTrue))) {
-            sq_settop(vm, top);
-            //if (!runtimeException)
-                throw RuntimeException(vm, "Error running script!");
-            //throw *runtimeException;
-        }
-
-        Object ret(vm);
-        sq_getstackobj(vm, -1, &ret.getRaw());
-        sq_addref(vm, &ret.getRaw());
-        sq_settop(vm, top);
-        return ret;
-    }
-
     void VM::debugStack() const {
         auto top = getTop();
         while(top >= 0) {
@@ -449,27 +1256,39 @@ namespace ssq {
         ));
     }
 */
-    void VM::pushArgs() {
-
-    }
-
-    std::unordered_map<size_t, HSQOBJECT> VM::classMap = {};
-
     void VM::addClassObj(size_t hashCode, const HSQOBJECT& obj) {
-        classMap[hashCode] = obj;
+        classRegistry.insert(hashCode, obj);
     }
 
-    const HSQOBJECT& VM::getClassObj(size_t hashCode) {
-        return classMap.at(hashCode);
+    const HSQOBJECT& VM::getClassObj(size_t hashCode) const {
+        const HSQOBJECT* obj = classRegistry.find(hashCode);
+        if (!obj) throw std::out_of_range("Class not registered");
+        return *obj;
     }
 
     namespace detail {
-        void addClassObj(size_t hashCode, const HSQOBJECT& obj) {
-            VM::addClassObj(hashCode, obj);
+        void addClassObj(HSQUIRRELVM vm, size_t hashCode, const HSQOBJECT& obj) {
+            VM* mainVM = static_cast<VM*>(sq_getsharedforeignptr(vm));
+            if (!mainVM) throw RuntimeException(vm, "Classes can only be added to a simplesquirrel VM!");
+            mainVM->addClassObj(hashCode, obj);
+        }
+
+        const HSQOBJECT& getClassObj(HSQUIRRELVM vm, size_t hashCode) {
+            VM* mainVM = static_cast<VM*>(sq_getsharedforeignptr(vm));
+            if (!mainVM) throw std::out_of_range("Class not registered");
+            return mainVM->getClassObj(hashCode);
+        }
+
+        const ClassRegistry* getClassRegistry(HSQUIRRELVM vm) {
+            VM* mainVM = static_cast<VM*>(sq_getsharedforeignptr(vm));
+            if (!mainVM) return nullptr;
+            return &mainVM->classRegistry;
         }
 
-        const HSQOBJECT& getClassObj(size_t hashCode) {
-            return VM::getClassObj(hashCode);
+        const Key& getVarTableKey(HSQUIRRELVM vm, bool set) {
+            VM* mainVM = static_cast<VM*>(sq_getsharedforeignptr(vm));
+            if (!mainVM) throw RuntimeException(vm, "Member variables can only be added in a simplesquirrel VM!");
+            return set ? mainVM->varSetKey : mainVM->varGetKey;
         }
     }
 }
@@ -0,0 +1,219 @@
+#include "simplesquirrel/vm_pool.hpp"
+#include "simplesquirrel/exceptions.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace ssq {
+    // The pool and worker of the calling thread, jobs queued from a worker stay on its deque
+    static thread_local VMPool* currentPool = nullptr;
+    static thread_local size_t currentWorker = 0;
+
+    // How long a worker sleeps after failing to take any of the queued jobs, doubled on each failure
+    static const std::chrono::microseconds minBackoff(10);
+    static const std::chrono::microseconds maxBackoff(1000);
+
+    VMPool::VMPool(size_t numWorkers, const Script& script, const Setup& setup, size_t stackSize, uint32_t flags):
+        next(0), pending(0), pushed(0), completed(0), sleeping(0), waiting(0), stopping(false) {
+        if (numWorkers == 0) {
+            numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // Compiled once, loaded into every VM
+        std::stringstream bytecode;
+        script.save(bytecode);
+        const std::string data = bytecode.str();
+
+        workers.reserve(numWorkers);
+        for (size_t i = 0; i < numWorkers; i++) {
+            std::unique_ptr<Worker> worker(new Worker(stackSize, flags));
+            if (setup) {
+                setup(worker->vm);
+            }
+            std::istringstream in(data);
+            Script loaded = worker->vm.loadBytecode(in);
+            worker->vm.run(loaded);
+            workers.push_back(std::move(worker));
+        }
+
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i]->thread = std::thread(&VMPool::run, this, i);
+        }
+    }
+
+    VMPool::~VMPool() {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            stopping = true;
+        }
+        idle.notify_all();
+
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    size_t VMPool::getNumOfWorkers() const {
+        return workers.size();
+    }
+
+    size_t VMPool::getNumOfPendingJobs() const {
+        return pending.load();
+    }
+
+    bool VMPool::isWorker() const {
+        return currentPool == this;
+    }
+
+    bool VMPool::runQueuedJob() {
+        Job job;
+        if (!pop(currentWorker, job) && !steal(currentWorker, job)) {
+            return false;
+        }
+        // Nested in the job that waits, on the VM of the same worker
+        runJob(job, workers[currentWorker]->vm);
+        return true;
+    }
+
+    void VMPool::runUntil(const std::function<bool()>& ready) {
+        std::chrono::microseconds backoff = minBackoff;
+        while (true) {
+            // Read before checking, so a job queued or finished after the check wakes this worker
+            const uint64_t seenPushed = pushed.load();
+            const uint64_t seenCompleted = completed.load();
+            if (ready()) {
+                return;
+            }
+            if (runQueuedJob()) {
+                backoff = minBackoff;
+                continue;
+            }
+
+            // The job runs on another worker
+            std::unique_lock<std::mutex> lock(idleMutex);
+            waiting.fetch_add(1);
+            auto woken = [&]() {
+                return pushed.load() != seenPushed || completed.load() != seenCompleted;
+            };
+            if (pending.load() != 0) {
+                // Jobs are queued, but their deques were locked
+                done.wait_for(lock, backoff, woken);
+                backoff = std::min(backoff * 2, maxBackoff);
+            } else {
+                done.wait(lock, woken);
+            }
+            waiting.fetch_sub(1);
+        }
+    }
+
+    void VMPool::runJob(Job& job, VM& vm) {
+        pending.fetch_sub(1);
+        job(vm);
+
+        // A worker counts itself as waiting before it checks the count, so either
+        // it sees this job finished or it's seen here and woken
+        completed.fetch_add(1);
+        if (waiting.load() != 0) {
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+            }
+            done.notify_all();
+        }
+    }
+
+    void VMPool::push(Job job) {
+        if (stopping) {
+            throw RuntimeException(nullptr, "VM pool is being destroyed");
+        }
+
+        // Counted before it's queued, so it can't be taken before it's counted
+        pending.fetch_add(1);
+
+        const size_t index = currentPool == this ? currentWorker : next.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        Worker& worker = *workers[index];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.jobs.push_back(std::move(job));
+        }
+
+        // A worker counts itself as sleeping or waiting before it checks for jobs,
+        // so either it sees this job or it's seen here and woken
+        pushed.fetch_add(1);
+        const bool wakeSleeping = sleeping.load() != 0;
+        const bool wakeWaiting = waiting.load() != 0;
+        if (wakeSleeping || wakeWaiting) {
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+            }
+            if (wakeSleeping) {
+                idle.notify_one();
+            }
+            if (wakeWaiting) {
+                done.notify_all();
+            }
+        }
+    }
+
+    bool VMPool::pop(size_t index, Job& job) {
+        Worker& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.jobs.empty()) {
+            return false;
+        }
+        // Newest first, its data is most likely still in the cache
+        job = std::move(worker.jobs.back());
+        worker.jobs.pop_back();
+        return true;
+    }
+
+    bool VMPool::steal(size_t index, Job& job) {
+        for (size_t i = 1; i < workers.size(); i++) {
+            Worker& victim = *workers[(index + i) % workers.size()];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+            if (lock.owns_lock() && !victim.jobs.empty()) {
+                // Oldest first, away from the end the owner works on
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void VMPool::run(size_t index) {
+        currentPool = this;
+        currentWorker = index;
+        VM& vm = workers[index]->vm;
+
+        std::chrono::microseconds backoff = minBackoff;
+        while (true) {
+            const uint64_t seen = pushed.load();
+            Job job;
+            if (pop(index, job) || steal(index, job)) {
+                runJob(job, vm);
+                backoff = minBackoff;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(idleMutex);
+            if (stopping && pending.load() == 0) {
+                break;
+            }
+            sleeping.fetch_add(1);
+            auto woken = [&]() {
+                return pushed.load() != seen || (stopping && pending.load() == 0);
+            };
+            if (pending.load() != 0) {
+                // Jobs are queued, but their deques were locked
+                idle.wait_for(lock, backoff, woken);
+                backoff = std::min(backoff * 2, maxBackoff);
+            } else {
+                idle.wait(lock, woken);
+            }
+            sleeping.fetch_sub(1);
+        }
+
+        currentPool = nullptr;
+    }
+}
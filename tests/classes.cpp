@@ -203,6 +203,140 @@ TEST_CASE("Register class") {
     REQUIRE(ret == 102030);
 }
 
+class StaticBound : public ssq::ExposableClass {
+public:
+    StaticBound(int val):val(val) {
+    }
+
+    void setVal(int val) {
+        this->val = val;
+    }
+
+    int getVal() const {
+        return val;
+    }
+
+    int add(int a, int b) {
+        return val + a + b;
+    }
+
+    int val;
+};
+
+TEST_CASE("Register class with compile time member function pointers") {
+    static const std::string source = STRINGIFY(
+        function bar() {
+            local instance = StaticBound(42);
+            instance.setVal(10);
+            return instance.getVal() + instance.add(1) + instance.add(1, 2);
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+
+    ssq::Class cls = vm.addClass("StaticBound", [](int val) -> StaticBound* {
+        return new StaticBound(val);
+    });
+    cls.addFunc<decltype(&StaticBound::setVal), &StaticBound::setVal>("setVal");
+    cls.addFunc<decltype(&StaticBound::getVal), &StaticBound::getVal>("getVal");
+    cls.addFunc<decltype(&StaticBound::add), &StaticBound::add>("add", ssq::DefaultArguments<int>(100));
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function bar = vm.findFunc("bar");
+    auto ret = vm.callFunc(bar, vm).toInt();
+
+    REQUIRE(ret == 10 + 111 + 13);
+}
+
+TEST_CASE("Registered classes are local to their VM") {
+    static const std::string source = STRINGIFY(
+        function bar() {
+            return typeof getPtr();
+        }
+    );
+
+    static StaticBound instance(5);
+
+    ssq::VM vm1(1024);
+    ssq::VM vm2(1024);
+
+    vm1.addClass("StaticBound", [](int val) -> StaticBound* {
+        return new StaticBound(val);
+    });
+
+    for (ssq::VM* vm : {&vm1, &vm2}) {
+        vm->addFunc("getPtr", []() -> StaticBound* {
+            return &instance;
+        });
+    }
+
+    ssq::Script script1 = vm1.compileSource(source.c_str());
+    vm1.run(script1);
+    ssq::Script script2 = vm2.compileSource(source.c_str());
+    vm2.run(script2);
+
+    REQUIRE(vm1.callFunc(vm1.findFunc("bar"), vm1).toString() == "instance");
+    REQUIRE(vm2.callFunc(vm2.findFunc("bar"), vm2).toString() == "userpointer");
+}
+
+TEST_CASE("Pushing a pointer picks up a class registered later") {
+    static const std::string source = STRINGIFY(
+        function bar() {
+            return typeof getPtr();
+        }
+    );
+
+    static StaticBound instance(5);
+
+    ssq::VM vm(1024);
+
+    vm.addFunc("getPtr", []() -> StaticBound* {
+        return &instance;
+    });
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE(vm.callFunc(vm.findFunc("bar"), vm).toString() == "userpointer");
+
+    vm.addClass("StaticBound", [](int val) -> StaticBound* {
+        return new StaticBound(val);
+    });
+
+    REQUIRE(vm.callFunc(vm.findFunc("bar"), vm).toString() == "instance");
+}
+
+TEST_CASE("Access member variables directly") {
+    static const std::string source = STRINGIFY(
+        function bar() {
+            local instance = StaticBound(42);
+            instance.val = instance.val + 1;
+            local failed = false;
+            try {
+                instance.val = "not an integer";
+            } catch (e) {
+                failed = true;
+            }
+            return failed ? instance.val : -1;
+        }
+    );
+
+    ssq::VM vm(1024);
+
+    ssq::Class cls = vm.addClass("StaticBound", [](int val) -> StaticBound* {
+        return new StaticBound(val);
+    });
+    cls.addVar("val", &StaticBound::val);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function bar = vm.findFunc("bar");
+    REQUIRE(vm.callFunc(bar, vm).toInt() == 43);
+}
+
 TEST_CASE("Register class with std::string type") {
     class Foo;
 
@@ -940,3 +1074,169 @@ TEST_CASE("Register class and extend it") {
     REQUIRE(fooPtr->getMsg() == "World");
 }
 
+
+TEST_CASE("Send a message from one VM to another") {
+    // Written out, as the commas would split the macro arguments of STRINGIFY
+    static const std::string producerSource =
+        "function produce() {\n"
+        "    return {\n"
+        "        name = \"order\",\n"
+        "        count = 3,\n"
+        "        price = 1.5,\n"
+        "        paid = true,\n"
+        "        items = [\"a\", \"b\", null],\n"
+        "        item = StaticBound(7),\n"
+        "        nested = { key = 42 }\n"
+        "    };\n"
+        "}\n"
+        "function cyclic() {\n"
+        "    local t = {};\n"
+        "    t.self <- t;\n"
+        "    return t;\n"
+        "}\n"
+        "function closure() {\n"
+        "    return [function() {}];\n"
+        "}\n";
+
+    static const std::string consumerSource = STRINGIFY(
+        function consume(msg) {
+            return msg.name + msg.count + msg.items.len() + msg.item.getVal() + msg.nested.key;
+        }
+    );
+
+    ssq::VM producer(1024);
+    ssq::VM consumer(1024);
+    for (ssq::VM* vm : {&producer, &consumer}) {
+        ssq::Class cls = vm->addClass("StaticBound", [](int val) -> StaticBound* {
+            return new StaticBound(val);
+        });
+        cls.addFunc<decltype(&StaticBound::getVal), &StaticBound::getVal>("getVal");
+    }
+
+    ssq::Script script = producer.compileSource(producerSource.c_str());
+    producer.run(script);
+    script = consumer.compileSource(consumerSource.c_str());
+    consumer.run(script);
+
+    ssq::Message message(producer.callFunc(producer.findFunc("produce"), producer));
+    REQUIRE(message.getType() == ssq::Type::TABLE);
+    REQUIRE(message.getSize() > 0);
+
+    // Copies share the captured data
+    ssq::Message copy = message;
+    ssq::Table table = copy.materialize(consumer).toTable();
+    REQUIRE(table.get<std::string>("name") == "order");
+    REQUIRE(table.get<int>("count") == 3);
+    REQUIRE(table.get<float>("price") == Approx(1.5f));
+    REQUIRE(table.get<bool>("paid") == true);
+    REQUIRE(table.find("items").toArray().size() == 3);
+    REQUIRE(table.find("item").getType() == ssq::Type::INSTANCE);
+
+    REQUIRE(consumer.callFunc<std::string>(consumer.findFunc("consume"), consumer, message) == "order33742");
+
+    REQUIRE_THROWS_AS(ssq::Message(producer.callFunc(producer.findFunc("cyclic"), producer)), const ssq::TypeException&);
+    REQUIRE_THROWS_AS(ssq::Message(producer.callFunc(producer.findFunc("closure"), producer)), const ssq::TypeException&);
+
+    ssq::Message empty;
+    REQUIRE(empty.isEmpty());
+    REQUIRE(empty.materialize(consumer).isNull());
+}
+
+class Overloaded : public ssq::ExposableClass {
+public:
+    std::string describe(int val) {
+        return "int " + std::to_string(val);
+    }
+
+    std::string describe(const std::string& val) const {
+        return "string " + val;
+    }
+
+    std::string describe(int a, int b) {
+        return "pair " + std::to_string(a + b);
+    }
+};
+
+TEST_CASE("Register overloaded functions under one name") {
+    // Written out, as the commas would split the macro arguments of STRINGIFY
+    static const std::string source =
+        "local o = Overloaded();\n"
+        "function callInt() { return o.describe(5); }\n"
+        "function callString() { return o.describe(\"five\"); }\n"
+        "function callPair() { return o.describe(2, 3); }\n"
+        "function callNone() { return o.describe(); }\n"
+        "function callWrongType() { return o.describe([]); }\n"
+        "function callSize() { return size([1, 2, 3]) + size({ a = 1 }); }\n";
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::Class cls = vm.addClass("Overloaded", []() -> Overloaded* {
+        return new Overloaded();
+    });
+    cls.addOverloads("describe",
+        static_cast<std::string(Overloaded::*)(int)>(&Overloaded::describe),
+        static_cast<std::string(Overloaded::*)(const std::string&) const>(&Overloaded::describe),
+        [](Overloaded* self, int a, int b) -> std::string {
+            return self->describe(a, b);
+        });
+    vm.addOverloads("size",
+        [](ssq::Array arr) -> int {
+            return static_cast<int>(arr.size());
+        },
+        [](ssq::Table table) -> int {
+            return static_cast<int>(table.size()) * 10;
+        });
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE(vm.callFunc<std::string>(vm.findFunc("callInt"), vm) == "int 5");
+    REQUIRE(vm.callFunc<std::string>(vm.findFunc("callString"), vm) == "string five");
+    REQUIRE(vm.callFunc<std::string>(vm.findFunc("callPair"), vm) == "pair 5");
+    REQUIRE(vm.callFunc<int>(vm.findFunc("callSize"), vm) == 13);
+
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("callNone"), vm), const ssq::RuntimeException&);
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("callWrongType"), vm), const ssq::RuntimeException&);
+}
+
+class OverloadedVec2 : public ssq::ExposableClass {
+public:
+    int x = 1;
+    int y = 2;
+};
+
+class OverloadedVec3 : public ssq::ExposableClass {
+public:
+    int x = 1;
+    int y = 2;
+    int z = 3;
+};
+
+TEST_CASE("Pick overloads by the class of an instance") {
+    static const std::string source = STRINGIFY(
+        function callVec2() { return sum(OverloadedVec2()); }
+        function callVec3() { return sum(OverloadedVec3()); }
+        function callTable() { return sum({}); }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.addClass("OverloadedVec2", []() -> OverloadedVec2* {
+        return new OverloadedVec2();
+    });
+    vm.addClass("OverloadedVec3", []() -> OverloadedVec3* {
+        return new OverloadedVec3();
+    });
+    vm.addOverloads("sum",
+        [](OverloadedVec2* vec) -> int {
+            return vec->x + vec->y;
+        },
+        [](const OverloadedVec3& vec) -> int {
+            return vec.x + vec.y + vec.z;
+        });
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE(vm.callFunc<int>(vm.findFunc("callVec2"), vm) == 3);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("callVec3"), vm) == 6);
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("callTable"), vm), const ssq::RuntimeException&);
+}
@@ -145,6 +145,164 @@ TEST_CASE("Register C++ lambda and call from squirrel") {
     REQUIRE(result == "30");
 }
 
+TEST_CASE("Call function with typed return value") {
+    static const std::string source = STRINGIFY(
+        local called = false;
+        function add(a, b) {
+            return a + b;
+        }
+        function touch() {
+            called = true;
+        }
+        function wasCalled() {
+            return called;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function add = vm.findFunc("add");
+
+    auto top = vm.getTop();
+
+    REQUIRE(vm.callFunc<int>(add, vm, 8, 4) == 12);
+    REQUIRE(vm.callFunc<float>(add, vm, 1.5f, 1.0f) == Approx(2.5f));
+    REQUIRE(vm.callFunc<std::string>(add, vm, std::string("foo"), std::string("bar")) == "foobar");
+    REQUIRE(vm.callFunc(add, vm, 8, 4).toInt() == 12);
+    REQUIRE_THROWS_AS(vm.callFunc<int>(add, vm, std::string("foo"), std::string("bar")), const ssq::TypeException&);
+
+    vm.callFunc<void>(vm.findFunc("touch"), vm);
+    REQUIRE(vm.callFunc<bool>(vm.findFunc("wasCalled"), vm) == true);
+
+    REQUIRE(top == vm.getTop());
+}
+
+TEST_CASE("Call bound function repeatedly") {
+    static const std::string source = STRINGIFY(
+        local counter = 0;
+        function add(a, b) {
+            counter++;
+            return a + b;
+        }
+        function reset() {
+            counter = 0;
+        }
+        function getCounter() {
+            return counter;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::BoundCall add(vm.findFunc("add"), vm);
+    REQUIRE(add.getNumOfParams().first == 2);
+    REQUIRE(add.getNumOfParams().second == 2);
+
+    auto top = vm.getTop();
+
+    REQUIRE(add(1, 2).toInt() == 3);
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(add.call<int>(i, i) == i * 2);
+    }
+    REQUIRE(add.call<std::string>(std::string("a"), std::string("b")) == "ab");
+    REQUIRE_THROWS_AS(add.call<int>(1), const ssq::RuntimeException&);
+    REQUIRE_THROWS_AS(add.call<int>(std::string("a"), std::string("b")), const ssq::TypeException&);
+
+    REQUIRE(top == vm.getTop());
+
+    ssq::BoundCall reset(vm.findFunc("reset"), vm);
+    ssq::BoundCall getCounter(vm.findFunc("getCounter"), vm);
+    REQUIRE(getCounter.call<int>() == 13);
+    reset.call<void>();
+    REQUIRE(getCounter.call<int>() == 0);
+
+    REQUIRE(top == vm.getTop());
+}
+
+static int staticAdd(int a, int b) {
+    return a + b;
+}
+
+TEST_CASE("Register C++ function pointer at compile time and call from squirrel") {
+    static const std::string source = STRINGIFY(
+        local result = foo(10, 20) + bar(1);
+        function getResult() {
+            return result;
+        }
+    );
+
+    ssq::VM vm(1024);
+
+    vm.addFunc<decltype(&staticAdd), &staticAdd>("foo");
+    vm.addFunc<decltype(&staticAdd), &staticAdd>("bar", ssq::DefaultArguments<int>(5));
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function getResult = vm.findFunc("getResult");
+
+    int result = vm.callFunc(getResult, vm).to<int>();
+
+    REQUIRE(result == 36);
+}
+
+class Offset : public ssq::ExposableClass {
+public:
+    Offset(int value = 1000):value(value) {
+    }
+
+    int value;
+};
+
+TEST_CASE("Use default arguments only for omitted arguments") {
+    static const std::string source = STRINGIFY(
+        function staticOmitted() {
+            return bar(1);
+        }
+        function staticPassed() {
+            return bar(1, 2);
+        }
+        function staticWrongType() {
+            return bar(1, "2");
+        }
+        function omitted() {
+            return shift(1);
+        }
+        function passed() {
+            return shift(1, Offset());
+        }
+        function wrongType() {
+            return shift(1, "2");
+        }
+    );
+
+    ssq::VM vm(1024);
+    vm.addFunc<decltype(&staticAdd), &staticAdd>("bar", ssq::DefaultArguments<int>(5));
+    vm.addClass("Offset", []() -> Offset* {
+        return new Offset(20);
+    });
+    // Class parameters accept any type to the typemask, so the binding checks the type
+    vm.addFunc("shift", [](int base, Offset offset) -> int {
+        return base + offset.value;
+    }, ssq::DefaultArguments<Offset>(Offset(300)));
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE(vm.callFunc<int>(vm.findFunc("staticOmitted"), vm) == 6);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("staticPassed"), vm) == 3);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("omitted"), vm) == 301);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("passed"), vm) == 21);
+
+    // A passed argument of the wrong type is an error, not replaced by the default
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("staticWrongType"), vm), const ssq::RuntimeException&);
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("wrongType"), vm), const ssq::RuntimeException&);
+}
+
 template<typename T>
 static void testType(T value, const std::string& type) {
     static const std::string source = STRINGIFY(
@@ -705,3 +863,305 @@ TEST_CASE("Test passing instance") {
     ssq::Script script = vm.compileSource(source.c_str());
     vm.run(script);
 }
+
+TEST_CASE("Pass strings to functions without a copy") {
+    static const std::string source =
+        "local line = log(\"route\", \"GET /index\");\n"
+        "if (line != \"GET /index\") throw \"log returned \" + line;\n"
+        "log(\"empty\", \"\");\n";
+
+    ssq::VM vm(1024);
+    std::vector<std::string> lines;
+
+    vm.addFunc("log", [&](ssq::StringRef tag, const ssq::StringRef& message) -> ssq::StringRef {
+        REQUIRE((tag == "route" || tag == "empty"));
+        REQUIRE(message.data() != nullptr);
+        lines.push_back(tag.str() + ":" + std::string(message.begin(), message.end()));
+        return message;
+    });
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE(lines.size() == 2);
+    REQUIRE(lines[0] == "route:GET /index");
+    REQUIRE(lines[1] == "empty:");
+
+#ifdef SSQ_CXX17
+    vm.addFunc("length", [](std::string_view str) -> int {
+        return static_cast<int>(str.size());
+    });
+    ssq::Script lengthScript = vm.compileSource("return length(\"Hello\");");
+    REQUIRE(vm.runAndReturn(lengthScript).toInt() == 5);
+#endif
+
+    ssq::Script invalid = vm.compileSource("log(\"route\", 42);");
+    REQUIRE_THROWS_AS(vm.run(invalid), const ssq::RuntimeException&);
+    REQUIRE(lines.size() == 2);
+}
+
+TEST_CASE("Count calls of bound native functions") {
+    static const std::string source =
+        "for (local i = 0; i < 10; i++) add(i, 1);\n"
+        "try { fail(); } catch (e) {}\n";
+
+    ssq::VM vm(1024);
+    vm.addFunc("add", [](int a, int b) -> int { return a + b; });
+    vm.addFunc("fail", []() -> void { throw std::runtime_error("failed"); });
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    std::vector<ssq::NativeCallStats> stats = vm.getNativeCallStats();
+#ifdef SSQ_NATIVE_PROFILER
+    REQUIRE(stats.size() == 2);
+    auto find = [&](const std::string& name) -> const ssq::NativeCallStats& {
+        return stats[0].name == name ? stats[0] : stats[1];
+    };
+    REQUIRE(find("add").calls == 10);
+    REQUIRE(find("add").exceptions == 0);
+    REQUIRE(find("add").maxNanoseconds <= find("add").totalNanoseconds);
+    REQUIRE(find("fail").calls == 1);
+    REQUIRE(find("fail").exceptions == 1);
+
+    vm.resetNativeCallStats();
+    REQUIRE(vm.getNativeCallStats()[0].calls == 0);
+#else
+    REQUIRE(stats.empty());
+#endif
+}
+
+TEST_CASE("Stop a script when its execution budget runs out") {
+    static const std::string source = STRINGIFY(
+        function spin(n) {
+            local i = 0;
+            while (n == 0 || i < n) {
+                i = tick(i);
+            }
+            return i;
+        }
+    );
+
+    ssq::VM vm(1024);
+    vm.addFunc("tick", [](int i) -> int { return i + 1; });
+
+    ssq::ExecutionBudget budget = { 1000, 0 };
+    vm.setExecutionBudget(budget);
+    REQUIRE(vm.getExecutionBudget().instructions == 1000);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function spin = vm.findFunc("spin");
+
+    REQUIRE_THROWS_AS(vm.callFunc(spin, vm, 0), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::INSTRUCTIONS);
+
+    // Within the budget
+    REQUIRE(vm.callFunc<int>(spin, vm, 10) == 10);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::NONE);
+
+    budget.instructions = 0;
+    budget.microseconds = 1000;
+    vm.setExecutionBudget(budget);
+    REQUIRE_THROWS_AS(vm.callFunc(spin, vm, 0), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::TIME);
+
+    vm.setExecutionBudget(ssq::ExecutionBudget());
+    REQUIRE(vm.callFunc<int>(spin, vm, 10000) == 10000);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::NONE);
+}
+
+#ifdef SSQ_SQUIRREL_INTERRUPT
+TEST_CASE("Stop a script loop that never calls a native function") {
+    static const std::string source = STRINGIFY(
+        function spin() {
+            while (true) {}
+        }
+        function spinAndCatch() {
+            while (true) {
+                try {
+                    while (true) {}
+                } catch (e) {
+                }
+            }
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::ExecutionBudget budget = { 1000, 0, true };
+    vm.setExecutionBudget(budget);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("spin"), vm), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::INSTRUCTIONS);
+    // Would catch the error forever if it could
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("spinAndCatch"), vm), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::INSTRUCTIONS);
+
+    budget.instructions = 0;
+    budget.microseconds = 1000;
+    vm.setExecutionBudget(budget);
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("spin"), vm), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::TIME);
+}
+
+TEST_CASE("Stop a script inside a try block") {
+    static const std::string source = STRINGIFY(
+        caught <- null;
+        function spinInTry() {
+            try {
+                while (true) {}
+            } catch (e) {
+                caught = e;
+            }
+            return "returned";
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::ExecutionBudget budget = { 1000, 0, false };
+    vm.setExecutionBudget(budget);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function spinInTry = vm.findFunc("spinInTry");
+
+    // By default the script catches the error like any other
+    REQUIRE(vm.callFunc<std::string>(spinInTry, vm) == "returned");
+    REQUIRE(vm.getStopReason() == ssq::StopReason::INSTRUCTIONS);
+    REQUIRE(vm.find("caught").toString() == "Instruction budget exceeded");
+
+    // Unwound through the try block
+    vm.set("caught", 0);
+    budget.uncatchable = true;
+    vm.setExecutionBudget(budget);
+    REQUIRE_THROWS_AS(vm.callFunc(spinInTry, vm), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::INSTRUCTIONS);
+    REQUIRE(vm.find("caught").toInt() == 0);
+}
+#endif
+
+static size_t debugHookCalls = 0;
+
+static void countDebugHook(HSQUIRRELVM vm, SQInteger type, const SQChar* sourcename, SQInteger line, const SQChar* funcname) {
+    debugHookCalls++;
+}
+
+static size_t debugHookLines = 0;
+
+// Line events are only raised by scripts compiled with debug info
+static void countLineHook(HSQUIRRELVM vm, SQInteger type, const SQChar* sourcename, SQInteger line, const SQChar* funcname) {
+    if (type == 'l') {
+        debugHookLines++;
+    }
+}
+
+TEST_CASE("Keep the native debug hook of the user during a budget") {
+    static const std::string source = STRINGIFY(
+        function sum(n) {
+            local s = 0;
+            for (local i = 0; i < n; i++) {
+                s += i;
+            }
+            return s;
+        }
+    );
+
+    ssq::VM vm(1024);
+    vm.setNativeDebugHook(&countDebugHook);
+    REQUIRE(vm.getNativeDebugHook() == &countDebugHook);
+    ssq::ExecutionBudget budget = { 1000000, 0 };
+    vm.setExecutionBudget(budget);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function sum = vm.findFunc("sum");
+
+    debugHookCalls = 0;
+    REQUIRE(vm.callFunc<int>(sum, vm, 10) == 45);
+    REQUIRE(debugHookCalls > 0);
+
+    // Set again once the budget is no longer used
+    vm.setExecutionBudget(ssq::ExecutionBudget());
+    debugHookCalls = 0;
+    REQUIRE(vm.callFunc<int>(sum, vm, 10) == 45);
+    REQUIRE(debugHookCalls > 0);
+
+    vm.setNativeDebugHook(nullptr);
+    debugHookCalls = 0;
+    REQUIRE(vm.callFunc<int>(sum, vm, 10) == 45);
+    REQUIRE(debugHookCalls == 0);
+}
+
+TEST_CASE("Sample call stacks of scripts") {
+    static const std::string source = STRINGIFY(
+        function inner(i) {
+            return i * 2;
+        }
+        function busy(n) {
+            local sum = 0;
+            for (local i = 0; i < n; i++) {
+                sum += inner(i);
+            }
+            return sum;
+        }
+    );
+
+    ssq::VM vm(1024);
+    REQUIRE(vm.isProfiling() == false);
+    vm.startProfiling(10);
+    REQUIRE(vm.isProfiling() == true);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function busy = vm.findFunc("busy");
+    vm.callFunc(busy, vm, 200000);
+
+    vm.stopProfiling();
+    REQUIRE(vm.isProfiling() == false);
+    const uint64_t samples = vm.getNumOfProfileSamples();
+    REQUIRE(samples > 0);
+
+    // Stopped, nothing more is sampled
+    vm.callFunc(busy, vm, 10000);
+    REQUIRE(vm.getNumOfProfileSamples() == samples);
+
+    std::stringstream out;
+    vm.writeCollapsedStacks(out);
+    uint64_t total = 0;
+    bool foundBusy = false;
+    std::string line;
+    while (std::getline(out, line)) {
+        const size_t space = line.rfind(' ');
+        REQUIRE(space != std::string::npos);
+        total += std::stoull(line.substr(space + 1));
+        foundBusy |= line.find(":busy:") != std::string::npos;
+    }
+    REQUIRE(total == samples);
+    REQUIRE(foundBusy);
+
+    vm.resetProfile();
+    REQUIRE(vm.getNumOfProfileSamples() == 0);
+
+    // Debug info is only on while profiling, unless it was on before
+    REQUIRE(vm.isDebugInfoEnabled() == false);
+    vm.setNativeDebugHook(&countLineHook);
+    ssq::Script plain = vm.compileSource("function plain() { local a = 1; return a; }");
+    vm.run(plain);
+    debugHookLines = 0;
+    vm.callFunc(vm.findFunc("plain"), vm);
+    REQUIRE(debugHookLines == 0);
+
+    vm.setDebugInfo(true);
+    vm.startProfiling(10);
+    vm.stopProfiling();
+    REQUIRE(vm.isDebugInfoEnabled() == true);
+    ssq::Script lines = vm.compileSource("function lines() { local a = 1; return a; }");
+    vm.run(lines);
+    debugHookLines = 0;
+    vm.callFunc(vm.findFunc("lines"), vm);
+    REQUIRE(debugHookLines > 0);
+    vm.setNativeDebugHook(nullptr);
+}
@@ -1,9 +1,35 @@
 #define CATCH_CONFIG_MAIN 
 #include "catch.hpp"
 #include <simplesquirrel/simplesquirrel.hpp>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define STRINGIFY(x) #x
 
+static void makeDir(const char* path) {
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+static void removeDir(const char* path) {
+#ifdef _WIN32
+    _rmdir(path);
+#else
+    rmdir(path);
+#endif
+}
+
 TEST_CASE("Create virtual machine"){
     ssq::VM sq(1024, ssq::Libs::ALL);
 
@@ -19,6 +45,321 @@ TEST_CASE("Create virtual machine"){
     // should fall out of scope with no errors
 }
 
+TEST_CASE("Reuse destroyed threads") {
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.addFunc("sum", [](int a, int b) -> int { return a + b; });
+    ssq::Script script = vm.compileSource("function foo(a) { return sum(a, 2); }");
+    vm.run(script);
+
+    HSQUIRRELVM handle;
+    {
+        ssq::VM thread = vm.newThread(1000);
+        handle = thread.getHandle();
+        REQUIRE(thread.callFunc<int>(thread.findFunc("foo"), thread, 1) == 3);
+    }
+    REQUIRE(vm.getNumOfPooledThreads() == 1);
+
+    {
+        // Same stack-size class
+        ssq::VM thread = vm.newThread(1024);
+        REQUIRE(thread.getHandle() == handle);
+        REQUIRE(vm.getNumOfPooledThreads() == 0);
+        REQUIRE(thread.callFunc<int>(thread.findFunc("foo"), thread, 2) == 4);
+
+        ssq::VM other = vm.newThread(4096);
+        REQUIRE(other.getHandle() != handle);
+    }
+    REQUIRE(vm.getNumOfPooledThreads() == 2);
+
+    vm.setThreadPoolSize(0);
+    REQUIRE(vm.getNumOfPooledThreads() == 0);
+    {
+        ssq::VM thread = vm.newThread(1024);
+    }
+    REQUIRE(vm.getNumOfPooledThreads() == 0);
+}
+
+// Counts the blocks allocated through it
+class CountingAllocator: public ssq::PoolAllocator {
+public:
+    size_t allocated = 0;
+    size_t released = 0;
+
+    virtual void* allocate(size_t size) override {
+        allocated++;
+        return ssq::PoolAllocator::allocate(size);
+    }
+    virtual void deallocate(void* ptr, size_t size) override {
+        released++;
+        ssq::PoolAllocator::deallocate(ptr, size);
+    }
+};
+
+TEST_CASE("Create virtual machine with an allocator") {
+    auto allocator = std::make_shared<CountingAllocator>();
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL, allocator);
+        REQUIRE(vm.getAllocator() == allocator.get());
+
+        ssq::VM moved = std::move(vm);
+        REQUIRE(moved.getAllocator() == allocator.get());
+
+        ssq::VM thread = moved.newThread(1024);
+        REQUIRE(thread.getAllocator() == allocator.get());
+
+        const size_t before = allocator->allocated;
+        moved.addFunc("sum", [](int a, int b) -> int { return a + b; });
+        REQUIRE(allocator->allocated > before);
+
+        ssq::Script script = moved.compileSource("function foo() { return sum(1, 2); }");
+        moved.run(script);
+        REQUIRE(moved.callFunc<int>(moved.findFunc("foo"), moved) == 3);
+    }
+    REQUIRE(allocator->allocated == allocator->released);
+}
+
+TEST_CASE("Fill a virtual machine within the allocator scope of another") {
+    auto other = std::make_shared<CountingAllocator>();
+    ssq::VM vm(1024);
+    {
+        ssq::VM scoped(1024, ssq::Libs::ALL, other);
+        ssq::AllocatorScope scope(scoped.getHandle());
+
+        ssq::Table table = vm.addTable("table");
+        table.set("greeting", std::string("Hello from the other VM"));
+        vm.addFunc("sum", [](int a, int b) -> int { return a + b; });
+    }
+    REQUIRE(other->allocated == other->released);
+
+    ssq::Script script = vm.compileSource("function foo() { return table.greeting + sum(1, 2); }");
+    vm.run(script);
+    REQUIRE(vm.callFunc<std::string>(vm.findFunc("foo"), vm) == "Hello from the other VM3");
+}
+
+#ifdef SSQ_CUSTOM_ALLOCATORS
+TEST_CASE("Memory accounting and limits") {
+    static const std::string source = STRINGIFY(
+        function bar() {
+            limit(1);
+            try {
+                foo(1);
+                return "no error";
+            } catch (e) {
+                return e;
+            }
+        }
+    );
+
+    ssq::VM vm(1024);
+    const ssq::MemoryStats before = vm.getMemoryStats();
+
+    vm.addFunc("foo", [](int a) -> int { return a; });
+    vm.addFunc("limit", [&vm](int bytes) { vm.setMemoryLimit(bytes); });
+
+    const ssq::MemoryStats after = vm.getMemoryStats();
+    REQUIRE(after.current > before.current);
+    REQUIRE(after.allocations > before.allocations);
+    REQUIRE(after.peak >= after.current);
+    REQUIRE(after.limit == 0);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function bar = vm.findFunc("bar");
+
+    REQUIRE(vm.callFunc<std::string>(bar, vm) == "Memory limit exceeded");
+    REQUIRE(vm.getMemoryStats().limit == 1);
+    REQUIRE_THROWS(vm.callFunc(bar, vm));
+
+    vm.setMemoryLimit(0);
+    vm.addFunc("limit", [](int) {});
+    REQUIRE(vm.callFunc<std::string>(bar, vm) == "no error");
+}
+#else
+TEST_CASE("Memory accounting needs custom allocators") {
+    ssq::VM vm(1024);
+    REQUIRE_THROWS_AS(vm.getMemoryStats(), const ssq::RuntimeException&);
+    REQUIRE_THROWS_AS(vm.setMemoryLimit(1024), const ssq::RuntimeException&);
+}
+#endif
+
+#if defined(SSQ_CUSTOM_ALLOCATORS) && defined(SSQ_SQUIRREL_INTERRUPT)
+TEST_CASE("Stop a script that allocates past the memory limit") {
+    static const std::string source = STRINGIFY(
+        function grow() {
+            local a = [];
+            while (true) a.push(a.len());
+        }
+        function growAndFree() {
+            local a = [];
+            try {
+                while (true) a.push(a.len());
+            } catch (e) {
+                a = null;
+            }
+            return "freed";
+        }
+        function growAfterCatching() {
+            local a = [];
+            while (true) {
+                try {
+                    while (true) a.push(a.len());
+                } catch (e) {
+                }
+            }
+        }
+    );
+
+    ssq::VM vm(1024);
+    vm.setMemoryLimit(vm.getMemoryStats().current + 1024 * 1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("grow"), vm), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::MEMORY);
+
+    REQUIRE(vm.callFunc<std::string>(vm.findFunc("growAndFree"), vm) == "freed");
+    REQUIRE(vm.getMemoryStats().current <= vm.getMemoryStats().limit);
+
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("growAfterCatching"), vm), const ssq::RuntimeException&);
+    REQUIRE(vm.getStopReason() == ssq::StopReason::MEMORY);
+}
+#endif
+
+TEST_CASE("Garbage collection policy") {
+    static const std::string source = STRINGIFY(
+        function makeCycles(n) {
+            for (local i = 0; i < n; i++) {
+                local t = {};
+                t.self <- t;
+            }
+            return n;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function makeCycles = vm.findFunc("makeCycles");
+
+    vm.callFunc(makeCycles, vm, 100);
+    REQUIRE(vm.collectGarbage() >= 100);
+    const ssq::GarbageCollectionStats& stats = vm.getGarbageCollectionStats();
+    REQUIRE(stats.collections == 1);
+    REQUIRE(stats.lastFreed >= 100);
+    REQUIRE(stats.totalFreed == stats.lastFreed);
+    REQUIRE(stats.maxMicroseconds == stats.lastMicroseconds);
+
+#ifdef SSQ_CUSTOM_ALLOCATORS
+    // Nothing allocated since, then allocations of the script are counted
+    REQUIRE(vm.collectGarbageAtIdle() == false);
+    vm.callFunc(makeCycles, vm, 1);
+#endif
+    {
+        ssq::GarbageCollectionPause pause(vm);
+        REQUIRE(vm.isGarbageCollectionPaused());
+        REQUIRE(vm.collectGarbageAtIdle() == false);
+    }
+    REQUIRE(vm.collectGarbageAtIdle() == true);
+    REQUIRE(stats.collections == 2);
+
+#ifdef SSQ_CUSTOM_ALLOCATORS
+    // Collected at the next safe point, calling into the VM is one
+    vm.setGarbageCollectionInterval(1);
+    REQUIRE(vm.getGarbageCollectionInterval() == 1);
+    vm.callFunc(makeCycles, vm, 10);
+    vm.callFunc(makeCycles, vm, 0);
+    REQUIRE(stats.collections > 2);
+
+    // Deferred until the pause ends
+    size_t collections = stats.collections;
+    vm.pauseGarbageCollection();
+    vm.callFunc(makeCycles, vm, 10);
+    vm.callFunc(makeCycles, vm, 0);
+    REQUIRE(stats.collections == collections);
+    vm.resumeGarbageCollection();
+    REQUIRE(stats.collections == collections + 1);
+    REQUIRE(stats.lastFreed >= 10);
+
+#ifdef SSQ_SQUIRREL_INTERRUPT
+    // Loops of scripts are safe points too
+    collections = stats.collections;
+    vm.callFunc(makeCycles, vm, 10);
+    REQUIRE(stats.collections >= collections + 5);
+#endif
+#else
+    // Allocations of scripts are not counted
+    REQUIRE_THROWS_AS(vm.setGarbageCollectionInterval(1), const ssq::RuntimeException&);
+    REQUIRE(vm.getGarbageCollectionInterval() == 0);
+#endif
+}
+
+#ifdef SSQ_CUSTOM_ALLOCATORS
+TEST_CASE("Collect garbage while a native function holds objects") {
+    static const std::string source = STRINGIFY(
+        function makeCycles(n) {
+            for (local i = 0; i < n; i++) {
+                local t = {};
+                t.self <- t;
+            }
+            return n;
+        }
+        function callHold() {
+            return hold({ value = 7 }, "held");
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    const ssq::GarbageCollectionStats& stats = vm.getGarbageCollectionStats();
+    vm.setGarbageCollectionInterval(1);
+
+    size_t collectionsInCall = 0;
+    vm.addFunc("hold", [&vm, &stats, &collectionsInCall](ssq::Table table, ssq::StringRef name) -> int {
+        ssq::Table local = vm.newTable();
+        local.set("value", 35);
+
+        // Only collected inside the script with SSQ_SQUIRREL_INTERRUPT, not by the nested call itself
+        const size_t collections = stats.collections;
+        vm.callFunc(vm.findFunc("makeCycles"), vm, 10);
+        collectionsInCall = stats.collections - collections;
+        vm.collectGarbage();
+
+        return table.get<int>("value") + local.get<int>("value") + (name == std::string("held") ? 4 : 0);
+    });
+
+    REQUIRE(vm.callFunc<int>(vm.findFunc("callHold"), vm) == 46);
+#ifdef SSQ_SQUIRREL_INTERRUPT
+    REQUIRE(collectionsInCall > 0);
+#else
+    REQUIRE(collectionsInCall == 0);
+#endif
+}
+#endif
+
+TEST_CASE("Arena and pool allocators") {
+    ssq::ArenaAllocator arena(1024);
+    void* a = arena.allocate(100);
+    void* b = arena.allocate(100);
+    REQUIRE(a != b);
+    REQUIRE(reinterpret_cast<uintptr_t>(b) % alignof(std::max_align_t) == 0);
+    // The most recent block grows in place
+    REQUIRE(arena.reallocate(b, 100, 200) == b);
+    REQUIRE(arena.allocate(4096) != nullptr);
+    REQUIRE(arena.getReserved() >= 1024 + 4096);
+    arena.release();
+    REQUIRE(arena.getReserved() == 0);
+
+    ssq::PoolAllocator pool;
+    void* c = pool.allocate(40);
+    pool.deallocate(c, 40);
+    // Same size class, the block is reused
+    REQUIRE(pool.allocate(48) == c);
+    void* big = pool.allocate(ssq::PoolAllocator::maxBlockSize + 1);
+    REQUIRE(big != nullptr);
+    pool.deallocate(big, ssq::PoolAllocator::maxBlockSize + 1);
+}
+
 TEST_CASE("Compile from source") {
     static const std::string source = STRINGIFY(
         class Foo {
@@ -93,4 +434,97 @@ TEST_CASE("Compile and run with exception"){
     ssq::Script script = vm.compileSource(source.c_str());
 
     REQUIRE_THROWS_AS(vm.run(script), ssq::RuntimeException);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Save and load bytecode") {
+    static const std::string source = STRINGIFY(
+        function foo(a, b) {
+            return a * b;
+        }
+    );
+
+    std::stringstream bytecode;
+    {
+        ssq::VM vm(1024);
+        ssq::Script script = vm.compileSource(source.c_str());
+        script.save(bytecode);
+    }
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.loadBytecode(bytecode);
+    REQUIRE(script.isEmpty() == false);
+    vm.run(script);
+
+    REQUIRE(vm.callFunc<int>(vm.findFunc("foo"), vm, 6, 7) == 42);
+
+    std::stringstream garbage("not bytecode");
+    REQUIRE_THROWS_AS(vm.loadBytecode(garbage), const ssq::CompileException&);
+}
+
+TEST_CASE("Compile file through the compile cache") {
+    static const char* dir = "test_compile_cache";
+    static const char* path = "test_compile_cache.nut";
+    makeDir(dir);
+    {
+        std::ofstream file(path);
+        file << "function foo() { return 42; }";
+    }
+
+    ssq::VM vm(1024);
+    vm.setCompileCache(dir);
+    REQUIRE(vm.getCompileCache() == dir);
+    const std::string cached = vm.getCompileCacheFile(path);
+    REQUIRE(cached.find(dir) == 0);
+    std::remove(cached.c_str());
+
+    ssq::Script script = vm.compileFile(path);
+    vm.run(script);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("foo"), vm) == 42);
+    REQUIRE(std::ifstream(cached).good());
+
+    // The source is unchanged, so the next compile loads whatever the cache holds
+    {
+        std::ofstream out(cached, std::ios::binary | std::ios::trunc);
+        vm.compileSource("function foo() { return 7; }").save(out);
+    }
+    ssq::VM vm2(1024);
+    vm2.setCompileCache(dir);
+    ssq::Script loaded = vm2.compileFile(path);
+    vm2.run(loaded);
+    REQUIRE(vm2.callFunc<int>(vm2.findFunc("foo"), vm2) == 7);
+
+    std::remove(cached.c_str());
+    std::remove(path);
+    removeDir(dir);
+}
+
+TEST_CASE("Compile from stream and mapped file") {
+    // Longer than a single chunk of the stream reader
+    std::string source = "function foo() {\n    local sum = 0;\n";
+    for (int i = 0; i < 500; i++) {
+        source += "    sum += " + std::to_string(i) + ";\n";
+    }
+    source += "    return sum;\n}";
+
+    static const char* path = "test_compile_mapped.nut";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "\xEF\xBB\xBF" << source;
+    }
+
+    ssq::VM vm(1024);
+
+    std::stringstream stream(source);
+    ssq::Script scriptA = vm.compileSource(stream, "stream");
+    vm.run(scriptA);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("foo"), vm) == 124750);
+
+    ssq::VM vm2(1024);
+    ssq::Script scriptB = vm2.compileFileMapped(path);
+    vm2.run(scriptB);
+    REQUIRE(vm2.callFunc<int>(vm2.findFunc("foo"), vm2) == 124750);
+
+    REQUIRE_THROWS_AS(vm2.compileFileMapped("does_not_exist.nut"), const ssq::CompileException&);
+
+    std::remove(path);
+}
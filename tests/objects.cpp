@@ -66,6 +66,141 @@ TEST_CASE("Find class and method") {
     REQUIRE(baz.isEmpty() == false);
 }
 
+TEST_CASE("Table lookups with pre-created keys") {
+    ssq::VM vm(1024);
+    ssq::Table table = vm.newTable();
+
+    ssq::Key state = vm.newKey("state");
+    REQUIRE(state.getName() == "state");
+
+    auto top = vm.getTop();
+
+    REQUIRE(table.hasEntry(state) == false);
+    REQUIRE_THROWS_AS(table.find(state), const ssq::NotFoundException&);
+
+    table.set(state, 42);
+    REQUIRE(table.hasEntry(state) == true);
+    REQUIRE(table.hasEntry("state") == true);
+    REQUIRE(table.get<int>(state) == 42);
+    REQUIRE(table.find(state).toInt() == 42);
+
+    int value = 0;
+    REQUIRE(table.get(state, value) == true);
+    REQUIRE(value == 42);
+    REQUIRE_THROWS_AS(table.get<std::string>(state), const ssq::TypeException&);
+
+    table.remove(state);
+    REQUIRE(table.hasEntry(state) == false);
+    REQUIRE(table.get(state, value) == false);
+
+    REQUIRE(top == vm.getTop());
+}
+
+TEST_CASE("Bulk array read and write") {
+    ssq::VM vm(1024);
+    auto top = vm.getTop();
+
+    const int ints[] = { 1, 2, 3, 4, 5 };
+    ssq::Array arr = vm.newArray(ints, 5);
+    REQUIRE(arr.size() == 5);
+    REQUIRE(arr.get<int>(4) == 5);
+    REQUIRE(top == vm.getTop());
+
+    const double reals[] = { 0.5, 1.5 };
+    arr.append(reals, 2);
+    arr.push(true);
+    REQUIRE(arr.size() == 8);
+    REQUIRE(arr.get<float>(6) == 1.5f);
+
+    // Partial reads from an offset, clamped to the end of the array
+    int buffer[4] = { 0 };
+    REQUIRE(arr.read(buffer, 4, 2) == 4);
+    REQUIRE(buffer[0] == 3);
+    REQUIRE(buffer[3] == 0);
+    REQUIRE(arr.read(buffer, 4, 6) == 2);
+    REQUIRE(buffer[0] == 1);
+    REQUIRE(buffer[1] == 1);
+    REQUIRE(arr.read(buffer, 4, 8) == 0);
+    REQUIRE(top == vm.getTop());
+
+    std::vector<float> floats;
+    REQUIRE_THROWS_AS(arr.read(floats), const ssq::TypeException&);
+    REQUIRE(top == vm.getTop());
+    arr.pop();
+    arr.read(floats);
+    REQUIRE(floats.size() == 7);
+    REQUIRE(floats[5] == 0.5f);
+    REQUIRE(arr.convert<int>() == std::vector<int>({ 1, 2, 3, 4, 5, 0, 1 }));
+
+    bool flags[2] = { false, false };
+    const bool values[] = { true, false };
+    ssq::Array flagsArr = vm.newArray(values, 2);
+    REQUIRE(flagsArr.read(flags, 2) == 2);
+    REQUIRE(flags[0] == true);
+    REQUIRE(flags[1] == false);
+    REQUIRE_THROWS_AS(arr.read(flags, 1), const ssq::TypeException&);
+    REQUIRE(top == vm.getTop());
+}
+
+TEST_CASE("Share C++ memory with scripts through buffers") {
+    static const std::string source =
+        "function scale(samples, gain) {\n"
+        "    for (local i = 0; i < samples.len(); i++) samples[i] = samples[i] * gain;\n"
+        "}\n"
+        "function sum(values) {\n"
+        "    local total = 0;\n"
+        "    foreach (i, v in values) total += v;\n"
+        "    return total;\n"
+        "}\n"
+        "function outOfRange(values) {\n"
+        "    return values[values.len()];\n"
+        "}\n"
+        "function write(values) {\n"
+        "    values[0] = 1;\n"
+        "}\n";
+
+    ssq::VM vm(1024, ssq::Libs::BUFFER);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    auto top = vm.getTop();
+
+    std::vector<float> samples = { 0.5f, 1.0f, -2.0f };
+    vm.callFunc(vm.findFunc("scale"), vm, ssq::Buffer<float>(samples), 2);
+    REQUIRE(samples[0] == 1.0f);
+    REQUIRE(samples[2] == -4.0f);
+    REQUIRE(top == vm.getTop());
+
+    const int16_t values[] = { 1, 2, 3, -4 };
+    ssq::Buffer<const int16_t> view(values, 4);
+    REQUIRE(vm.callFunc(vm.findFunc("sum"), vm, view).toInt() == 2);
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("outOfRange"), vm, view), const ssq::RuntimeException&);
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("write"), vm, view), const ssq::RuntimeException&);
+    REQUIRE(values[0] == 1);
+    REQUIRE(top == vm.getTop());
+
+    // Buffers passed back to C++ point at the same memory, and check their element type
+    std::vector<uint8_t> bytes(16, 0);
+    vm.addFunc("fill", [](ssq::Buffer<uint8_t> buffer, int value) -> size_t {
+        for (uint8_t& byte : buffer) {
+            byte = static_cast<uint8_t>(value);
+        }
+        return buffer.size();
+    });
+    vm.addFunc("first", [](ssq::Buffer<const float> buffer) -> float {
+        return buffer[0];
+    });
+    ssq::Script fill = vm.compileSource("return fill(buffer, 255);");
+    vm.set("buffer", ssq::Buffer<uint8_t>(bytes));
+    REQUIRE(vm.runAndReturn(fill).toInt() == 16);
+    REQUIRE(bytes[15] == 255);
+
+    ssq::Script wrongType = vm.compileSource("return first(buffer);");
+    REQUIRE_THROWS_AS(vm.run(wrongType), const ssq::RuntimeException&);
+    vm.set("buffer", ssq::Buffer<const uint8_t>(bytes));
+    REQUIRE_THROWS_AS(vm.run(fill), const ssq::RuntimeException&);
+    REQUIRE(top == vm.getTop());
+}
+
 TEST_CASE("Test stack manipulation") {
     static const std::string source = STRINGIFY(
         class Foo {
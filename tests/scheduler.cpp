@@ -0,0 +1,226 @@
+#define CATCH_CONFIG_MAIN 
+#include "catch.hpp"
+#include <simplesquirrel/simplesquirrel.hpp>
+#include <thread>
+
+#define STRINGIFY(x) #x
+
+TEST_CASE("Spawn threads and yield") {
+    static const std::string source = STRINGIFY(
+        log <- [];
+        function worker(name, steps) {
+            for (local i = 0; i < steps; i++) {
+                log.append(name + i);
+                sleep(0);
+            }
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Scheduler scheduler(vm);
+    scheduler.registerFunctions(vm);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function worker = vm.findFunc("worker");
+
+    ssq::Scheduler::ThreadId a = scheduler.spawn(worker, vm, std::string("a"), 2);
+    ssq::Scheduler::ThreadId b = scheduler.spawn(worker, vm, std::string("b"), 1);
+    REQUIRE(a != b);
+    REQUIRE(scheduler.getNumOfThreads() == 2);
+    REQUIRE(scheduler.isAlive(a));
+
+    REQUIRE_THROWS_AS(scheduler.spawn(worker, vm, std::string("c")), const ssq::RuntimeException&);
+
+    REQUIRE(scheduler.update() == 2);
+    REQUIRE(scheduler.update() == 2);
+    // Thread b has finished
+    REQUIRE(scheduler.getNumOfThreads() == 1);
+    REQUIRE(scheduler.isAlive(b) == false);
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(scheduler.getNumOfThreads() == 0);
+    REQUIRE(scheduler.update() == 0);
+
+    std::vector<std::string> log = vm.find("log").toArray().convert<std::string>();
+    REQUIRE(log.size() == 3);
+    REQUIRE(log[0] == "a0");
+    REQUIRE(log[1] == "b0");
+    REQUIRE(log[2] == "a1");
+
+    // The slot of a finished thread is reused with a new ID
+    ssq::Scheduler::ThreadId c = scheduler.spawn(worker, vm, std::string("c"), 1);
+    REQUIRE(c != a);
+    REQUIRE(c != b);
+}
+
+TEST_CASE("Wait for a thread to be woken") {
+    static const std::string source = STRINGIFY(
+        result <- null;
+        function waiter() {
+            result = wait();
+            result += wait();
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Scheduler scheduler(vm);
+    scheduler.registerFunctions(vm);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function waiter = vm.findFunc("waiter");
+
+    ssq::Scheduler::ThreadId id = scheduler.spawn(waiter, vm);
+    REQUIRE(scheduler.update() == 1);
+    // Waiting threads are not resumed
+    REQUIRE(scheduler.update() == 0);
+    REQUIRE(scheduler.getTimeToNextUpdate() == std::chrono::steady_clock::duration::max());
+
+    REQUIRE(scheduler.wake(id, 40));
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(vm.find("result").toInt() == 40);
+
+    scheduler.notify(id);
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(scheduler.isAlive(id) == false);
+    REQUIRE(scheduler.wake(id) == false);
+
+    // Woken before waiting, wait() returns immediately
+    id = scheduler.spawn(waiter, vm);
+    REQUIRE(scheduler.wake(id, 1));
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(vm.find("result").toInt() == 1);
+    REQUIRE(scheduler.kill(id));
+    REQUIRE(scheduler.isAlive(id) == false);
+    REQUIRE(scheduler.getNumOfThreads() == 0);
+}
+
+TEST_CASE("Wake a sleeping thread and wait afterwards") {
+    static const std::string source = STRINGIFY(
+        slept <- null;
+        result <- null;
+        function napper(seconds) {
+            slept = sleep(seconds);
+            result = wait();
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Scheduler scheduler(vm);
+    scheduler.registerFunctions(vm);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function napper = vm.findFunc("napper");
+
+    // Woken during sleep(0), the value is returned by sleep() and wait() still waits
+    ssq::Scheduler::ThreadId id = scheduler.spawn(napper, vm, 0);
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(scheduler.wake(id, 10));
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(vm.find("slept").toInt() == 10);
+    REQUIRE(vm.find("result").getType() == ssq::Type::NULLPTR);
+    REQUIRE(scheduler.update() == 0);
+    REQUIRE(scheduler.wake(id, 20));
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(vm.find("result").toInt() == 20);
+    REQUIRE(scheduler.isAlive(id) == false);
+
+    // The same while sleeping on a timer
+    vm.set("slept", 0);
+    id = scheduler.spawn(napper, vm, 0.01);
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(scheduler.wake(id, 30));
+    while (scheduler.update() == 0) {
+        std::this_thread::sleep_for(scheduler.getTimeToNextUpdate());
+    }
+    REQUIRE(vm.find("slept").toInt() == 30);
+    REQUIRE(scheduler.isAlive(id));
+    REQUIRE(scheduler.update() == 0);
+    REQUIRE(scheduler.wake(id, 40));
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(vm.find("result").toInt() == 40);
+}
+
+TEST_CASE("Report errors of threads") {
+    static const std::string source = STRINGIFY(
+        function failer() {
+            sleep(0);
+            throw "thread error";
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Scheduler scheduler(vm);
+    scheduler.registerFunctions(vm);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    std::vector<ssq::Scheduler::ThreadId> failed;
+    std::string message;
+    scheduler.setErrorHandler([&](ssq::Scheduler::ThreadId id, const ssq::RuntimeException& error) {
+        failed.push_back(id);
+        message = error.what();
+    });
+
+    ssq::Scheduler::ThreadId id = scheduler.spawn(vm.findFunc("failer"), vm);
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(failed.empty());
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(failed.size() == 1);
+    REQUIRE(failed[0] == id);
+    REQUIRE(message.find("thread error") != std::string::npos);
+    REQUIRE(scheduler.isAlive(id) == false);
+    REQUIRE(scheduler.getNumOfThreads() == 0);
+}
+
+TEST_CASE("Sleep in a thread") {
+    static const std::string source = STRINGIFY(
+        done <- false;
+        function sleeper() {
+            sleep(0.05);
+            done = true;
+        }
+        function quitter() {
+            quit();
+            sleep(0);
+            done = true;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Scheduler scheduler(vm);
+    scheduler.registerFunctions(vm);
+    vm.addFunc("quit", [&scheduler]() -> bool {
+        return scheduler.kill(scheduler.getCurrent());
+    });
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    // Can only be used from a thread of the scheduler
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("sleeper"), vm), const ssq::RuntimeException&);
+    vm.set("done", false);
+
+    scheduler.spawn(vm.findFunc("sleeper"), vm);
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(scheduler.update() == 0);
+    REQUIRE(vm.find("done").toBool() == false);
+    REQUIRE(scheduler.getTimeToNextUpdate() > std::chrono::steady_clock::duration::zero());
+
+    while (scheduler.getNumOfThreads() != 0) {
+        std::this_thread::sleep_for(scheduler.getTimeToNextUpdate());
+        scheduler.update();
+    }
+    REQUIRE(vm.find("done").toBool() == true);
+
+    // A thread killing itself is released once it gives up control
+    vm.set("done", false);
+    ssq::Scheduler::ThreadId id = scheduler.spawn(vm.findFunc("quitter"), vm);
+    REQUIRE(scheduler.update() == 1);
+    REQUIRE(scheduler.isAlive(id) == false);
+    REQUIRE(scheduler.getNumOfThreads() == 0);
+    REQUIRE(scheduler.update() == 0);
+    REQUIRE(vm.find("done").toBool() == false);
+}
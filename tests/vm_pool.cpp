@@ -0,0 +1,119 @@
+#define CATCH_CONFIG_MAIN 
+#include "catch.hpp"
+#include <simplesquirrel/simplesquirrel.hpp>
+
+#define STRINGIFY(x) #x
+
+TEST_CASE("Call functions on a pool of VMs") {
+    static const std::string source = STRINGIFY(
+        calls <- 0;
+        function fib(n) {
+            calls++;
+            return n < 2 ? n : fib(n - 1) + fib(n - 2);
+        }
+        function greet(name) {
+            return prefix() + name;
+        }
+        function fail() {
+            throw "failed";
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+
+    std::atomic<int> setups(0);
+    ssq::VMPool pool(4, script, [&setups](ssq::VM& worker) {
+        setups++;
+        worker.addFunc("prefix", []() -> std::string { return "Hello "; });
+    });
+    REQUIRE(pool.getNumOfWorkers() == 4);
+    REQUIRE(setups == 4);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; i++) {
+        results.push_back(pool.call<int>("fib", i % 20));
+    }
+    for (int i = 0; i < 100; i++) {
+        const int n = i % 20;
+        int a = 0, b = 1;
+        for (int j = 0; j < n; j++) {
+            const int c = a + b;
+            a = b;
+            b = c;
+        }
+        REQUIRE(results[i].get() == a);
+    }
+
+    REQUIRE(pool.call<std::string>("greet", std::string("World")).get() == "Hello World");
+    REQUIRE_THROWS_AS(pool.call("fail").get(), const ssq::RuntimeException&);
+    REQUIRE_THROWS_AS(pool.call("missing").get(), const ssq::NotFoundException&);
+
+    // Each worker has its own VM
+    std::future<int> calls = pool.submit([](ssq::VM& worker) -> int {
+        return worker.find("calls").toInt();
+    });
+    REQUIRE(calls.get() >= 0);
+    REQUIRE(vm.find("calls").isEmpty());
+
+    // Jobs queued from a worker
+    std::future<int> nested = pool.submit([&pool](ssq::VM&) -> int {
+        std::future<int> result = pool.call<int>("fib", 10);
+        return pool.get(result);
+    });
+    REQUIRE(pool.get(nested) == 55);
+}
+
+TEST_CASE("Wait for jobs queued from the only worker") {
+    static const std::string source = STRINGIFY(
+        function square(n) {
+            return n * n;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    ssq::VMPool pool(1, script);
+
+    // The worker would wait forever for the jobs queued behind the one it runs
+    std::future<int> sum = pool.submit([&pool](ssq::VM&) -> int {
+        std::vector<std::future<int>> squares;
+        for (int i = 1; i <= 3; i++) {
+            squares.push_back(pool.call<int>("square", i));
+        }
+        int result = 0;
+        for (auto& square : squares) {
+            result += pool.get(square);
+        }
+        return result;
+    });
+    REQUIRE(sum.get() == 14);
+
+    std::future<void> failed = pool.submit([&pool](ssq::VM&) {
+        std::future<void> result = pool.call("missing");
+        pool.get(result);
+    });
+    REQUIRE_THROWS_AS(failed.get(), const ssq::NotFoundException&);
+}
+
+TEST_CASE("Wait for a job running on another worker") {
+    static const std::string source = STRINGIFY(
+        function one() {
+            return 1;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    ssq::VMPool pool(2, script);
+
+    // Nothing is left to run while the other worker sleeps, so the waiting worker blocks until it's done
+    std::future<int> slow = pool.submit([](ssq::VM& worker) -> int {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return worker.callFunc<int>(worker.findFunc("one"), worker);
+    });
+    std::future<int> waiting = pool.submit([&pool, &slow](ssq::VM&) -> int {
+        return pool.get(slow) + 1;
+    });
+    REQUIRE(waiting.get() == 2);
+}